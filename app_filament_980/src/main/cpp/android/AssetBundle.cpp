@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AssetBundle.h"
+#include "Path.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace utils {
+
+static constexpr char BUNDLE_MAGIC[8] = { 'F', 'I', 'L', 'A', 'B', 'N', 'D', 'L' };
+static constexpr uint32_t BUNDLE_VERSION = 1;
+static constexpr size_t BUNDLE_HEADER_SIZE = sizeof(BUNDLE_MAGIC) + 2 * sizeof(uint32_t);
+static constexpr size_t BUNDLE_DATA_ALIGNMENT = 16;
+
+AssetBundle::~AssetBundle() noexcept {
+    close();
+}
+
+void AssetBundle::close() noexcept {
+    mIndex.clear();
+    if (mMapping) {
+        munmap(mMapping, mMappingSize);
+        mMapping = nullptr;
+        mMappingSize = 0;
+    }
+    mAsset = {};
+    mData = nullptr;
+    mSize = 0;
+}
+
+bool AssetBundle::map(const char* path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        mapping = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // the mapping keeps the file alive
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    mMapping = mapping;
+    mMappingSize = size_t(st.st_size);
+    if (!parse(mapping, size_t(st.st_size))) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool AssetBundle::open(AssetSource const& source, const char* name) {
+    close();
+    mAsset = source.open(name);
+    if (!mAsset || !parse(mAsset.getData(), mAsset.getSize())) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool AssetBundle::parse(void const* data, size_t size) noexcept {
+    uint8_t const* const bytes = static_cast<uint8_t const*>(data);
+    if (size < BUNDLE_HEADER_SIZE || memcmp(bytes, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC))) {
+        return false;
+    }
+    uint32_t version, count;
+    memcpy(&version, bytes + sizeof(BUNDLE_MAGIC), sizeof(uint32_t));
+    memcpy(&count, bytes + sizeof(BUNDLE_MAGIC) + sizeof(uint32_t), sizeof(uint32_t));
+    if (version != BUNDLE_VERSION || count > (size - BUNDLE_HEADER_SIZE) / sizeof(Entry)) {
+        return false;
+    }
+
+    mIndex.reserve(count);
+    uint8_t const* p = bytes + BUNDLE_HEADER_SIZE;
+    for (uint32_t i = 0; i < count; i++, p += sizeof(Entry)) {
+        Entry entry;
+        memcpy(&entry, p, sizeof(Entry));
+        if (uint64_t(entry.pathOffset) + entry.pathLength > size ||
+                entry.offset > size || entry.size > size - entry.offset) {
+            mIndex.clear();
+            return false;
+        }
+        std::string_view path((char const*) bytes + entry.pathOffset, entry.pathLength);
+        mIndex[path] = { bytes + entry.offset, size_t(entry.size) };
+    }
+    mData = bytes;
+    mSize = size;
+    return true;
+}
+
+AssetBundle::Asset AssetBundle::find(std::string_view path) const noexcept {
+    auto iter = mIndex.find(path);
+    return iter != mIndex.end() ? iter->second : Asset{};
+}
+
+bool AssetBundle::write(const char* path,
+        std::vector<std::pair<std::string, std::string>> const& files) {
+    std::vector<std::pair<std::string, std::vector<char>>> assets;
+    assets.reserve(files.size());
+    for (auto const& file : files) {
+        std::ifstream in(file.second, std::ifstream::binary);
+        if (!in) {
+            return false;
+        }
+        assets.emplace_back(Path(file.first).getPath(),
+                std::vector<char>(std::istreambuf_iterator<char>(in), {}));
+    }
+    std::sort(assets.begin(), assets.end(), [](auto const& lhs, auto const& rhs) {
+        return lhs.first < rhs.first;
+    });
+
+    uint32_t const count = uint32_t(assets.size());
+    size_t pathOffset = BUNDLE_HEADER_SIZE + count * sizeof(Entry);
+    size_t dataOffset = pathOffset;
+    for (auto const& asset : assets) {
+        dataOffset += asset.first.size();
+    }
+
+    std::vector<Entry> entries;
+    entries.reserve(count);
+    for (auto const& asset : assets) {
+        dataOffset = (dataOffset + BUNDLE_DATA_ALIGNMENT - 1) & ~(BUNDLE_DATA_ALIGNMENT - 1);
+        entries.push_back({ uint32_t(pathOffset), uint32_t(asset.first.size()),
+                dataOffset, asset.second.size() });
+        pathOffset += asset.first.size();
+        dataOffset += asset.second.size();
+    }
+
+    std::ofstream out(path, std::ofstream::binary | std::ofstream::trunc);
+    out.write(BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC));
+    out.write((char const*) &BUNDLE_VERSION, sizeof(uint32_t));
+    out.write((char const*) &count, sizeof(uint32_t));
+    out.write((char const*) entries.data(), entries.size() * sizeof(Entry));
+    for (auto const& asset : assets) {
+        out.write(asset.first.data(), asset.first.size());
+    }
+    for (size_t i = 0; i < count; i++) {
+        while (size_t(out.tellp()) < entries[i].offset) {
+            out.put(0);
+        }
+        out.write(assets[i].second.data(), assets[i].second.size());
+    }
+    return bool(out);
+}
+
+} // namespace utils
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UTILS_ASSETBUNDLE_H_
+#define UTILS_ASSETBUNDLE_H_
+
+#include "AssetSource.h"
+
+#include <tsl/robin_map.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace utils {
+
+/**
+ * A read-only bundle packing many small assets in a single file, mapped in memory once.
+ * Looking an asset up hashes its path once and returns a pointer into the mapping, no file is
+ * opened and nothing is copied.
+ *
+ * Layout, little-endian:
+ *   char     magic[8]          "FILABNDL"
+ *   uint32_t version
+ *   uint32_t count
+ *   Entry    entries[count]    sorted by path
+ *   char     paths[]           not null terminated
+ *   uint8_t  data[]            each asset aligned to 16 bytes
+ *
+ * Paths are stored in their canonical form (see utils::Path), so that the ones built with
+ * Path::concat() by the loaders can be looked up as they are.
+ */
+class AssetBundle {
+public:
+    struct Asset {
+        void const* data = nullptr;
+        size_t size = 0;
+
+        explicit operator bool() const noexcept { return data != nullptr; }
+    };
+
+    AssetBundle() noexcept = default;
+    ~AssetBundle() noexcept;
+
+    AssetBundle(AssetBundle const&) = delete;
+    AssetBundle& operator=(AssetBundle const&) = delete;
+
+    /**
+     * Maps the bundle stored in a regular file.
+     *
+     * @return false if the file cannot be mapped or isn't a valid bundle
+     */
+    bool map(const char* path);
+
+    /**
+     * Opens a bundle from another asset source, which is kept open as long as the bundle is.
+     * A bundle stored in the APK should not be compressed (see aaptOptions.noCompress) so that
+     * it is mapped rather than inflated in memory.
+     */
+    bool open(AssetSource const& source, const char* name);
+
+    Asset find(std::string_view path) const noexcept;
+
+    size_t getCount() const noexcept { return mIndex.size(); }
+
+    /**
+     * Writes a bundle, for host-side tooling.
+     *
+     * @param files pairs of (path in the bundle, path of the file to read)
+     */
+    static bool write(const char* path,
+            std::vector<std::pair<std::string, std::string>> const& files);
+
+private:
+    struct Entry {
+        uint32_t pathOffset;
+        uint32_t pathLength;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    bool parse(void const* data, size_t size) noexcept;
+    void close() noexcept;
+
+    uint8_t const* mData = nullptr;
+    size_t mSize = 0;
+    void* mMapping = nullptr;
+    // set along with mMapping, mSize is only valid once the bundle is parsed
+    size_t mMappingSize = 0;
+    AssetSource::Asset mAsset;
+    // keys point into the mapping
+    tsl::robin_map<std::string_view, Asset> mIndex;
+};
+
+} // namespace utils
+
+#endif // UTILS_ASSETBUNDLE_H_
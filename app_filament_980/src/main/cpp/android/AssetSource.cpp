@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AssetSource.h"
+#include "AssetBundle.h"
+
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__ANDROID__)
+#include <android/asset_manager.h>
+#endif
+
+namespace utils {
+
+AssetSource::Asset::~Asset() noexcept {
+    if (mClose) {
+        mClose(mData, mSize, mHandle);
+    }
+}
+
+AssetSource::Asset::Asset(Asset&& rhs) noexcept {
+    std::swap(mClose, rhs.mClose);
+    std::swap(mData, rhs.mData);
+    std::swap(mSize, rhs.mSize);
+    std::swap(mHandle, rhs.mHandle);
+}
+
+AssetSource::Asset& AssetSource::Asset::operator=(Asset&& rhs) noexcept {
+    if (this != &rhs) {
+        std::swap(mClose, rhs.mClose);
+        std::swap(mData, rhs.mData);
+        std::swap(mSize, rhs.mSize);
+        std::swap(mHandle, rhs.mHandle);
+    }
+    return *this;
+}
+
+AssetSource::Asset AssetSource::make(void const* data, size_t size, void* handle,
+        CloseCallback close) noexcept {
+    Asset asset;
+    asset.mClose = close;
+    asset.mData = data;
+    asset.mSize = size;
+    asset.mHandle = handle;
+    return asset;
+}
+
+// ------------------------------------------------------------------------------------------------
+
+#if defined(__ANDROID__)
+AssetSource::Asset AAssetSource::open(const char* path) const {
+    AAsset* asset = AAssetManager_open(mAssetManager, path, AASSET_MODE_BUFFER);
+    if (!asset) {
+        return {};
+    }
+    void const* data = AAsset_getBuffer(asset);
+    if (!data) {
+        AAsset_close(asset);
+        return {};
+    }
+    return make(data, size_t(AAsset_getLength(asset)), asset, &AAssetSource::close);
+}
+
+void AAssetSource::close(void const*, size_t, void* handle) noexcept {
+    AAsset_close(static_cast<AAsset*>(handle));
+}
+#endif
+
+// ------------------------------------------------------------------------------------------------
+
+AssetSource::Asset DirectorySource::open(const char* path) const {
+    Path const file(mRoot.concat(path));
+    int fd = ::open(file.getPath().c_str(), O_RDONLY);
+    if (fd < 0) {
+        return {};
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return {};
+    }
+    if (st.st_size == 0) {
+        // nothing to map, but the asset exists
+        ::close(fd);
+        static char const sEmpty = 0;
+        return make(&sEmpty, 0, nullptr);
+    }
+    void* data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps the file alive
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return {};
+    }
+    return make(data, size_t(st.st_size), data, &DirectorySource::close);
+}
+
+void DirectorySource::close(void const*, size_t size, void* handle) noexcept {
+    munmap(handle, size);
+}
+
+// ------------------------------------------------------------------------------------------------
+
+AssetSource::Asset BundleSource::open(const char* path) const {
+    if (mBundle) {
+        AssetBundle::Asset const asset = mBundle->find(path);
+        if (asset) {
+            // owned by the bundle, nothing to close
+            return make(asset.data, asset.size, nullptr);
+        }
+    }
+    return mFallback.open(path);
+}
+
+} // namespace utils
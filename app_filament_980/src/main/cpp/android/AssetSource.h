@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UTILS_ASSETSOURCE_H_
+#define UTILS_ASSETSOURCE_H_
+
+#include "Path.h"
+
+#include <stddef.h>
+
+#if defined(__ANDROID__)
+struct AAssetManager;
+#endif
+
+namespace utils {
+
+class AssetBundle;
+
+/**
+ * Where the loaders read their assets from. Opening an asset gives read-only access to its
+ * whole content, which stays valid until the returned Asset is destroyed. An Asset doesn't
+ * reference its source and can outlive it, e.g. to be released from an engine callback.
+ *
+ * Sources can be stacked (see BundleSource), and since the loaders only ever see this interface
+ * they can run against a plain directory off-device.
+ */
+class AssetSource {
+public:
+    class Asset {
+    public:
+        Asset() noexcept = default;
+        ~Asset() noexcept;
+
+        Asset(Asset const&) = delete;
+        Asset& operator=(Asset const&) = delete;
+        Asset(Asset&& rhs) noexcept;
+        Asset& operator=(Asset&& rhs) noexcept;
+
+        void const* getData() const noexcept { return mData; }
+        size_t getSize() const noexcept { return mSize; }
+
+        explicit operator bool() const noexcept { return mData != nullptr; }
+
+    private:
+        friend class AssetSource;
+        using CloseCallback = void(*)(void const* data, size_t size, void* handle);
+        CloseCallback mClose = nullptr;
+        void const* mData = nullptr;
+        size_t mSize = 0;
+        void* mHandle = nullptr;
+    };
+
+    virtual ~AssetSource() noexcept = default;
+
+    /**
+     * Opens the asset at the given path, relative to the root of the source.
+     *
+     * @return an empty Asset if it doesn't exist or cannot be read
+     */
+    virtual Asset open(const char* path) const = 0;
+
+    Asset open(Path const& path) const { return open(path.getPath().c_str()); }
+
+protected:
+    using CloseCallback = Asset::CloseCallback;
+
+    // Wraps data owned by this source, close is called with handle when the asset goes away.
+    static Asset make(void const* data, size_t size, void* handle,
+            CloseCallback close = nullptr) noexcept;
+};
+
+#if defined(__ANDROID__)
+/**
+ * Assets packaged in the APK.
+ */
+class AAssetSource : public AssetSource {
+public:
+    explicit AAssetSource(AAssetManager* assetManager) noexcept : mAssetManager(assetManager) { }
+
+    Asset open(const char* path) const override;
+    using AssetSource::open;
+
+private:
+    static void close(void const* data, size_t size, void* handle) noexcept;
+
+    AAssetManager* mAssetManager;
+};
+#endif
+
+/**
+ * Regular files under a root directory, each one mapped in memory when opened.
+ */
+class DirectorySource : public AssetSource {
+public:
+    explicit DirectorySource(Path root) noexcept : mRoot(std::move(root)) { }
+
+    Asset open(const char* path) const override;
+    using AssetSource::open;
+
+private:
+    static void close(void const* data, size_t size, void* handle) noexcept;
+
+    Path mRoot;
+};
+
+/**
+ * Looks assets up in a bundle first and opens them from another source otherwise. The bundle
+ * can be null, in which case every asset comes from the fallback.
+ */
+class BundleSource : public AssetSource {
+public:
+    BundleSource(AssetBundle const* bundle, AssetSource const& fallback) noexcept
+            : mBundle(bundle), mFallback(fallback) { }
+
+    Asset open(const char* path) const override;
+    using AssetSource::open;
+
+private:
+    AssetBundle const* mBundle;
+    AssetSource const& mFallback;
+};
+
+} // namespace utils
+
+#endif // UTILS_ASSETSOURCE_H_
@@ -17,18 +17,38 @@
 #include "NioUtils.h"
 #include "CallbackUtils.h"
 
-void acquireCallbackJni(JNIEnv* env, CallbackJni& callbackUtils) {
+#include <utils/Allocator.h>
+
+#include <atomic>
+
+static CallbackJni sCallbackJni;
+
+void initCallbackJni(JNIEnv* env) {
 #ifdef ANDROID
-    callbackUtils.handlerClass = env->FindClass("android/os/Handler");
-    callbackUtils.handlerClass = (jclass) env->NewGlobalRef(callbackUtils.handlerClass);
-    callbackUtils.post = env->GetMethodID(callbackUtils.handlerClass,
+    jclass handlerClass = env->FindClass("android/os/Handler");
+    sCallbackJni.handlerClass = (jclass) env->NewGlobalRef(handlerClass);
+    sCallbackJni.post = env->GetMethodID(sCallbackJni.handlerClass,
             "post", "(Ljava/lang/Runnable;)Z");
+    env->DeleteLocalRef(handlerClass);
 #endif
 
-    callbackUtils.executorClass = env->FindClass("java/util/concurrent/Executor");
-    callbackUtils.executorClass = (jclass) env->NewGlobalRef(callbackUtils.executorClass);
-    callbackUtils.execute = env->GetMethodID(callbackUtils.executorClass,
-                                              "execute", "(Ljava/lang/Runnable;)V");
+    jclass executorClass = env->FindClass("java/util/concurrent/Executor");
+    sCallbackJni.executorClass = (jclass) env->NewGlobalRef(executorClass);
+    sCallbackJni.execute = env->GetMethodID(sCallbackJni.executorClass,
+                                             "execute", "(Ljava/lang/Runnable;)V");
+    env->DeleteLocalRef(executorClass);
+}
+
+void terminateCallbackJni(JNIEnv* env) {
+#ifdef ANDROID
+    env->DeleteGlobalRef(sCallbackJni.handlerClass);
+#endif
+    env->DeleteGlobalRef(sCallbackJni.executorClass);
+    sCallbackJni = {};
+}
+
+void acquireCallbackJni(JNIEnv*, CallbackJni& callbackUtils) {
+    callbackUtils = sCallbackJni;
 }
 
 void releaseCallbackJni(JNIEnv* env, CallbackJni callbackUtils, jobject handler, jobject callback) {
@@ -44,33 +64,83 @@ void releaseCallbackJni(JNIEnv* env, CallbackJni callbackUtils, jobject handler,
     }
     env->DeleteGlobalRef(handler);
     env->DeleteGlobalRef(callback);
-#ifdef ANDROID
-    env->DeleteGlobalRef(callbackUtils.handlerClass);
-#endif
-    env->DeleteGlobalRef(callbackUtils.executorClass);
 }
 
+// Buffer callbacks are created for every upload, they come from a fixed size lock-free pool and
+// only fall back to the heap when it's exhausted.
+static constexpr size_t BUFFER_CALLBACK_POOL_COUNT = 1024;
+
+using BufferCallbackPool = utils::Arena<
+        utils::ThreadSafeObjectPoolAllocator<JniBufferCallback>,
+        utils::LockingPolicy::NoLock>;
+
+static BufferCallbackPool& getBufferCallbackPool() {
+    static BufferCallbackPool pool("JniBufferCallback",
+            BUFFER_CALLBACK_POOL_COUNT * sizeof(JniBufferCallback));
+    return pool;
+}
+
+// Callbacks completed by the engine, waiting for the next flush()
+static std::atomic<JniBufferCallback*> sCompletedBufferCallbacks{ nullptr };
+
+// Image callbacks posted from threads that can't call into Java, waiting for the next flush()
+static std::atomic<JniImageCallback*> sPostedImageCallbacks{ nullptr };
+
 JniBufferCallback* JniBufferCallback::make(filament::Engine* engine,
         JNIEnv* env, jobject handler, jobject callback, AutoBuffer&& buffer) {
-    return new JniBufferCallback(env, handler, callback, std::move(buffer));
+    void* p = getBufferCallbackPool().alloc(sizeof(JniBufferCallback), alignof(JniBufferCallback));
+    if (!p) {
+        return new JniBufferCallback(env, handler, callback, std::move(buffer));
+    }
+    JniBufferCallback* data = new(p) JniBufferCallback(env, handler, callback, std::move(buffer));
+    data->mPooled = true;
+    return data;
 }
 
 JniBufferCallback::JniBufferCallback(JNIEnv* env, jobject handler, jobject callback,
         AutoBuffer&& buffer)
         : mEnv(env)
-        , mHandler(env->NewGlobalRef(handler))
-        , mCallback(env->NewGlobalRef(callback))
+        , mHandler(handler ? env->NewGlobalRef(handler) : nullptr)
+        , mCallback(callback ? env->NewGlobalRef(callback) : nullptr)
         , mBuffer(std::move(buffer)) {
     acquireCallbackJni(env, mCallbackUtils);
 }
 
 JniBufferCallback::~JniBufferCallback() {
+    // mBuffer is destroyed after this, with the same env
+    mBuffer.setEnv(mEnv);
     releaseCallbackJni(mEnv, mCallbackUtils, mHandler, mCallback);
 }
 
+void JniBufferCallback::destroy(JniBufferCallback* data) {
+    if (data->mPooled) {
+        data->~JniBufferCallback();
+        getBufferCallbackPool().free(data, sizeof(JniBufferCallback));
+    } else {
+        delete data;
+    }
+}
+
 void JniBufferCallback::invoke(void*, size_t, void* user) {
     JniBufferCallback* data = reinterpret_cast<JniBufferCallback*>(user);
-    delete data;
+    JniBufferCallback* head = sCompletedBufferCallbacks.load(std::memory_order_relaxed);
+    do {
+        data->mNext = head;
+    } while (!sCompletedBufferCallbacks.compare_exchange_weak(head, data,
+            std::memory_order_release, std::memory_order_relaxed));
+}
+
+void JniBufferCallback::flush(JNIEnv* env) {
+    JniBufferCallback* data = sCompletedBufferCallbacks.exchange(nullptr,
+            std::memory_order_acquire);
+    while (data) {
+        JniBufferCallback* const next = data->mNext;
+        // release with the flushing thread's env, the one captured by make() may not be
+        // valid here
+        data->mEnv = env;
+        destroy(data);
+        data = next;
+    }
 }
 
 // -----------------------------------------------------------------------------------------------
@@ -97,6 +167,25 @@ void JniImageCallback::invoke(void*, void* user) {
     delete data;
 }
 
+void JniImageCallback::post(void*, void* user) {
+    JniImageCallback* data = reinterpret_cast<JniImageCallback*>(user);
+    JniImageCallback* head = sPostedImageCallbacks.load(std::memory_order_relaxed);
+    do {
+        data->mNext = head;
+    } while (!sPostedImageCallbacks.compare_exchange_weak(head, data,
+            std::memory_order_release, std::memory_order_relaxed));
+}
+
+void JniImageCallback::flush(JNIEnv* env) {
+    JniImageCallback* data = sPostedImageCallbacks.exchange(nullptr, std::memory_order_acquire);
+    while (data) {
+        JniImageCallback* const next = data->mNext;
+        data->mEnv = env;
+        delete data;
+        data = next;
+    }
+}
+
 // -----------------------------------------------------------------------------------------------
 
 JniCallback* JniCallback::make(JNIEnv* env, jobject handler, jobject callback) {
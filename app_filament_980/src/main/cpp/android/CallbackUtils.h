@@ -32,6 +32,10 @@ struct CallbackJni {
     jmethodID execute = nullptr;
 };
 
+// Resolves the Handler/Executor classes once, must be called from JNI_OnLoad.
+void initCallbackJni(JNIEnv* env);
+void terminateCallbackJni(JNIEnv* env);
+
 void acquireCallbackJni(JNIEnv* env, CallbackJni& callbackUtils);
 void releaseCallbackJni(JNIEnv* env, CallbackJni callbackUtils, jobject handler, jobject callback);
 
@@ -39,19 +43,28 @@ struct JniBufferCallback {
     static JniBufferCallback* make(filament::Engine* engine,
             JNIEnv* env, jobject handler, jobject callback, AutoBuffer&& buffer);
 
+    // Called by the engine on its own thread, only queues the callback for flush().
     static void invoke(void* buffer, size_t n, void* user);
 
+    // Releases every callback completed since the last call in one batch. This must be called
+    // from a thread attached to the JVM, typically once per frame.
+    static void flush(JNIEnv* env);
+
 private:
     JniBufferCallback(JNIEnv* env, jobject handler, jobject callback, AutoBuffer&& buffer);
     JniBufferCallback(JniBufferCallback const &) = delete;
     JniBufferCallback(JniBufferCallback&&) = delete;
     ~JniBufferCallback();
 
+    static void destroy(JniBufferCallback* data);
+
     JNIEnv* mEnv;
     jobject mHandler;
     jobject mCallback;
     AutoBuffer mBuffer;
     CallbackJni mCallbackUtils;
+    JniBufferCallback* mNext = nullptr;
+    bool mPooled = false;
 };
 
 struct JniImageCallback {
@@ -60,6 +73,12 @@ struct JniImageCallback {
 
     static void invoke(void* image, void* user);
 
+    // For threads that aren't attached to the JVM, only queues the callback for flush().
+    static void post(void* image, void* user);
+
+    // Releases every callback posted since the last call, see JniBufferCallback::flush().
+    static void flush(JNIEnv* env);
+
 private:
     JniImageCallback(JNIEnv* env, jobject handler, jobject runnable, long image);
     JniImageCallback(JniImageCallback const &) = delete;
@@ -71,6 +90,7 @@ private:
     jobject mCallback;
     long mImage;
     CallbackJni mCallbackUtils;
+    JniImageCallback* mNext = nullptr;
 };
 
 struct JniCallback {
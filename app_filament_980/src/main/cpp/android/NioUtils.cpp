@@ -18,26 +18,39 @@
 
 #include <algorithm>
 
-AutoBuffer::AutoBuffer(JNIEnv *env, jobject buffer, jint size, bool commit) noexcept :
-        mEnv(env),
-        mDoCommit(commit) {
+AutoBuffer::NioUtils AutoBuffer::sNioUtils{};
 
-    mNioUtils.jniClass = env->FindClass("ru/arvrlab/hardcoreFilament/utils/NioUtils");
-    mNioUtils.jniClass = (jclass) env->NewGlobalRef(mNioUtils.jniClass);
+void AutoBuffer::init(JNIEnv* env) noexcept {
+    NioUtils& nioUtils = sNioUtils;
+    jclass jniClass = env->FindClass("ru/arvrlab/hardcoreFilament/utils/NioUtils");
+    nioUtils.jniClass = (jclass) env->NewGlobalRef(jniClass);
+    env->DeleteLocalRef(jniClass);
 
-    mNioUtils.getBasePointer = env->GetStaticMethodID(mNioUtils.jniClass,
+    nioUtils.getBasePointer = env->GetStaticMethodID(nioUtils.jniClass,
             "getBasePointer", "(Ljava/nio/Buffer;JI)J");
-    mNioUtils.getBaseArray = env->GetStaticMethodID(mNioUtils.jniClass,
+    nioUtils.getBaseArray = env->GetStaticMethodID(nioUtils.jniClass,
             "getBaseArray", "(Ljava/nio/Buffer;)Ljava/lang/Object;");
-    mNioUtils.getBaseArrayOffset = env->GetStaticMethodID(mNioUtils.jniClass,
+    nioUtils.getBaseArrayOffset = env->GetStaticMethodID(nioUtils.jniClass,
             "getBaseArrayOffset", "(Ljava/nio/Buffer;I)I");
-    mNioUtils.getBufferType = env->GetStaticMethodID(mNioUtils.jniClass,
+    nioUtils.getBufferType = env->GetStaticMethodID(nioUtils.jniClass,
             "getBufferType", "(Ljava/nio/Buffer;)I");
+}
+
+void AutoBuffer::terminate(JNIEnv* env) noexcept {
+    env->DeleteGlobalRef(sNioUtils.jniClass);
+    sNioUtils = {};
+}
+
+AutoBuffer::AutoBuffer(JNIEnv *env, jobject buffer, jint size, bool commit) noexcept :
+        mEnv(env),
+        mDoCommit(commit) {
+
+    NioUtils const& nioUtils = sNioUtils;
 
     mBuffer = env->NewGlobalRef(buffer);
 
     mType = (BufferType) env->CallStaticIntMethod(
-                mNioUtils.jniClass, mNioUtils.getBufferType, mBuffer);
+                nioUtils.jniClass, nioUtils.getBufferType, mBuffer);
 
     switch (mType) {
         case BufferType::BYTE:
@@ -62,16 +75,16 @@ AutoBuffer::AutoBuffer(JNIEnv *env, jobject buffer, jint size, bool commit) noex
     jlong address = (jlong) env->GetDirectBufferAddress(mBuffer);
     if (address) {
         // Direct buffer case
-        mData = reinterpret_cast<void *>(env->CallStaticLongMethod(mNioUtils.jniClass,
-                mNioUtils.getBasePointer, mBuffer, address, mShift));
+        mData = reinterpret_cast<void *>(env->CallStaticLongMethod(nioUtils.jniClass,
+                nioUtils.getBasePointer, mBuffer, address, mShift));
         mUserData = mData;
     } else {
         // wrapped array case
-        jarray array = (jarray) env->CallStaticObjectMethod(mNioUtils.jniClass,
-                mNioUtils.getBaseArray, mBuffer);
+        jarray array = (jarray) env->CallStaticObjectMethod(nioUtils.jniClass,
+                nioUtils.getBaseArray, mBuffer);
 
-        jint offset = env->CallStaticIntMethod(mNioUtils.jniClass,
-                mNioUtils.getBaseArrayOffset, mBuffer, mShift);
+        jint offset = env->CallStaticIntMethod(nioUtils.jniClass,
+                nioUtils.getBaseArrayOffset, mBuffer, mShift);
 
         mBaseArray = (jarray) env->NewGlobalRef(array);
         switch (mType) {
@@ -110,7 +123,7 @@ AutoBuffer::AutoBuffer(AutoBuffer &&rhs) noexcept {
     std::swap(mShift, rhs.mShift);
     std::swap(mBuffer, rhs.mBuffer);
     std::swap(mBaseArray, rhs.mBaseArray);
-    std::swap(mNioUtils, rhs.mNioUtils);
+    std::swap(mDoCommit, rhs.mDoCommit);
 }
 
 AutoBuffer::~AutoBuffer() noexcept {
@@ -145,5 +158,4 @@ AutoBuffer::~AutoBuffer() noexcept {
     if (mBuffer) {
         env->DeleteGlobalRef(mBuffer);
     }
-    mEnv->DeleteGlobalRef(mNioUtils.jniClass);
 }
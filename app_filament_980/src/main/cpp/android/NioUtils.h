@@ -32,6 +32,11 @@ public:
         DOUBLE
     };
 
+    // Resolves the NioUtils class and methods once, must be called from JNI_OnLoad before
+    // any AutoBuffer is created.
+    static void init(JNIEnv* env) noexcept;
+    static void terminate(JNIEnv* env) noexcept;
+
     // Clients should pass "true" for the commit argument if they intend to mutate the buffer
     // contents from native code.
     AutoBuffer(JNIEnv* env, jobject buffer, jint size, bool commit = false) noexcept;
@@ -54,6 +59,12 @@ public:
         return count << mShift;
     }
 
+    // The buffer is released with env instead of the one it was created with, for buffers
+    // released on another thread.
+    void setEnv(JNIEnv* env) noexcept {
+        mEnv = env;
+    }
+
 private:
     void* mUserData = nullptr;
     size_t mSize = 0;
@@ -66,11 +77,11 @@ private:
     jarray mBaseArray = nullptr;
     bool mDoCommit = false;
 
-    struct {
+    static struct NioUtils {
         jclass jniClass;
         jmethodID getBasePointer;
         jmethodID getBaseArray;
         jmethodID getBaseArrayOffset;
         jmethodID getBufferType;
-    } mNioUtils{};
+    } sNioUtils;
 };
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CameraStream.h"
+
+#include <filament/Engine.h>
+
+#include <algorithm>
+
+using namespace filament;
+
+CameraStream::~CameraStream() {
+    destroy();
+}
+
+Stream* CameraStream::createNative(void* surfaceTexture) {
+    destroy();
+    mStream = Stream::Builder().stream(surfaceTexture).build(mEngine);
+    return mStream;
+}
+
+Stream* CameraStream::createTextureId(intptr_t textureId, uint32_t width, uint32_t height) {
+    destroy();
+    mStream = Stream::Builder().stream(textureId).width(width).height(height).build(mEngine);
+    return mStream;
+}
+
+Stream* CameraStream::createAcquired(uint32_t width, uint32_t height) {
+    destroy();
+    // streams are ACQUIRED unless given a native stream or a texture id
+    mStream = Stream::Builder().width(width).height(height).build(mEngine);
+    return mStream;
+}
+
+void CameraStream::destroy() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        release(mPending);
+    }
+    if (mStream) {
+        mEngine.destroy(mStream);
+        mStream = nullptr;
+    }
+    mLastTimestamp = 0;
+}
+
+void CameraStream::release(Image& image) noexcept {
+    if (image.image && image.release) {
+        image.release(image.image, image.user);
+    }
+    image = {};
+}
+
+void CameraStream::pushImage(void* image, int64_t timestampNanos, Stream::Callback release,
+        void* user) {
+    Image previous;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        previous = mPending;
+        mPending = { image, timestampNanos, release, user };
+        if (previous.image) {
+            mDropped++;
+        }
+    }
+    // released outside of the lock, it may call into Java
+    CameraStream::release(previous);
+}
+
+bool CameraStream::latch(int64_t vsyncNanos) {
+    if (!mStream) {
+        return false;
+    }
+
+    if (mStream->getStreamType() != Stream::StreamType::ACQUIRED) {
+        // the engine latches the latest frame itself, a new timestamp means a new frame
+        int64_t const timestamp = mStream->getTimestamp();
+        if (timestamp == mLastTimestamp) {
+            return false;
+        }
+        mLastTimestamp = timestamp;
+        record(vsyncNanos, timestamp);
+        return true;
+    }
+
+    Image image;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        image = mPending;
+        mPending = {};
+        mStats.dropped += mDropped;
+        mDropped = 0;
+    }
+    if (!image.image) {
+        return false;
+    }
+    if (mMaxAgeNanos > 0 && vsyncNanos - image.timestamp > mMaxAgeNanos) {
+        mStats.stale++;
+        release(image);
+        return false;
+    }
+    mStream->setAcquiredImage(image.image, image.release, image.user);
+    record(vsyncNanos, image.timestamp);
+    return true;
+}
+
+void CameraStream::record(int64_t vsyncNanos, int64_t timestampNanos) noexcept {
+    // images can be timestamped after the vsync they're latched on
+    float const latencyMs = float(std::max(vsyncNanos - timestampNanos, int64_t(0))) * 1e-6f;
+    mStats.frames++;
+    mStats.maxLatencyMs = std::max(mStats.maxLatencyMs, latencyMs);
+    mLatencySumMs += latencyMs;
+}
+
+CameraStream::Stats CameraStream::resetStats() noexcept {
+    Stats stats = mStats;
+    stats.averageLatencyMs = stats.frames ? float(mLatencySumMs / stats.frames) : 0.0f;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        stats.dropped += mDropped;
+        mDropped = 0;
+    }
+    mStats = {};
+    mLatencySumMs = 0.0;
+    return stats;
+}
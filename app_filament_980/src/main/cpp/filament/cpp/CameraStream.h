@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_CAMERASTREAM_H
+#define TNT_FILAMENT_SAMPLE_CAMERASTREAM_H
+
+#include <filament/Stream.h>
+
+#include <mutex>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The camera feed shown in the scene, as a NATIVE (SurfaceTexture), TEXTURE_ID or ACQUIRED
+ * stream, along with its latency metrics.
+ *
+ * ACQUIRED streams are the low latency path: images are pushed from any thread as the camera
+ * produces them and the most recent one is latched right before the frame starts. An image
+ * replaced before it could be latched is dropped, as is one older than the maximum age by the
+ * time its frame starts.
+ *
+ * The latency of a camera frame is measured from its timestamp to the vsync of the first frame
+ * showing it, so both must come from the same clock (CLOCK_MONOTONIC, as System.nanoTime()).
+ */
+class CameraStream {
+public:
+    struct Stats {
+        uint32_t frames = 0;    // camera frames shown
+        uint32_t dropped = 0;   // replaced by a newer image before being shown
+        uint32_t stale = 0;     // older than the maximum age when their frame started
+        float averageLatencyMs = 0.0f;
+        float maxLatencyMs = 0.0f;
+    };
+
+    explicit CameraStream(filament::Engine& engine) noexcept : mEngine(engine) { }
+
+    // Destroys the stream, images that weren't latched yet are released.
+    ~CameraStream();
+
+    CameraStream(CameraStream const&) = delete;
+    CameraStream& operator=(CameraStream const&) = delete;
+
+    // Each of these replaces the current stream, if any.
+    filament::Stream* createNative(void* surfaceTexture);
+    filament::Stream* createTextureId(intptr_t textureId, uint32_t width, uint32_t height);
+    filament::Stream* createAcquired(uint32_t width, uint32_t height);
+
+    void destroy() noexcept;
+
+    filament::Stream* getStream() const noexcept { return mStream; }
+
+    /**
+     * Queues an image for an ACQUIRED stream, release is called once the engine is done with it
+     * or when it's dropped, on the render thread or the one pushing the next image. Can be called
+     * from any thread.
+     */
+    void pushImage(void* image, int64_t timestampNanos,
+            filament::Stream::Callback release, void* user);
+
+    // Images older than this when their frame starts are dropped, 0 keeps them all.
+    void setMaxAge(int64_t nanos) noexcept { mMaxAgeNanos = nanos; }
+
+    /**
+     * Hands the most recent image to the engine and updates the metrics. Must be called on the
+     * render thread, right before Renderer::beginFrame(), with the vsync of that frame.
+     *
+     * @return true if a new camera frame will be shown
+     */
+    bool latch(int64_t vsyncNanos);
+
+    // Returns the metrics accumulated since the last call and resets them.
+    Stats resetStats() noexcept;
+
+private:
+    struct Image {
+        void* image = nullptr;
+        int64_t timestamp = 0;
+        filament::Stream::Callback release = nullptr;
+        void* user = nullptr;
+    };
+
+    static void release(Image& image) noexcept;
+    void record(int64_t vsyncNanos, int64_t timestampNanos) noexcept;
+
+    filament::Engine& mEngine;
+    filament::Stream* mStream = nullptr;
+    int64_t mMaxAgeNanos = 0;
+    int64_t mLastTimestamp = 0;
+
+    std::mutex mLock;
+    Image mPending;     // guarded by mLock
+    uint32_t mDropped = 0; // guarded by mLock
+
+    Stats mStats;
+    double mLatencySumMs = 0.0;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_CAMERASTREAM_H
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_COMMANDRING_H
+#define TNT_FILAMENT_SAMPLE_COMMANDRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Native side of a command ring living in memory shared with Java (a direct ByteBuffer, see
+ * CommandRing.kt). Java appends commands and advances its write index, the render loop drains
+ * everything written so far once per frame.
+ *
+ * This is a batch buffer for a single thread, not a concurrent queue: Java writes the indices
+ * with plain stores (a release store on a direct buffer needs API 33), so commands must be
+ * written on the thread that calls render(), whose JNI transition orders them before drain().
+ *
+ * Layout, all values in native byte order:
+ *   [HEAD_OFFSET]  uint32 write index in bytes, only written by Java
+ *   [TAIL_OFFSET]  uint32 read index in bytes, only written by native
+ *   [DATA_OFFSET]  ring storage, its size must be a power of two
+ *
+ * A command is a uint32 header (command << 16 | payload word count) followed by its payload,
+ * a command never wraps around the end of the storage, a PADDING command fills the gap instead.
+ */
+class CommandRing {
+public:
+    // Must match CommandRing.kt
+    enum class Command : uint16_t {
+        PADDING = 0,
+        UPDATE_MATERIAL,        // metallic, roughness, clearCoat
+        UPDATE_MATERIAL_ALBEDO, // r, g, b (sRGB)
+        UPDATE_TRANSFORM,       // no payload
+    };
+
+    static constexpr size_t HEAD_OFFSET = 0;
+    static constexpr size_t TAIL_OFFSET = 64;   // head and tail on separate cache lines
+    static constexpr size_t DATA_OFFSET = 128;
+
+    CommandRing() noexcept = default;
+
+    // Returns an invalid ring if size doesn't leave room for a power-of-two storage.
+    CommandRing(void* buffer, size_t size) noexcept {
+        size_t const capacity = size > DATA_OFFSET ? size - DATA_OFFSET : 0;
+        if (buffer && capacity >= 16 && !(capacity & (capacity - 1)) && capacity <= UINT32_MAX) {
+            uint8_t* const base = static_cast<uint8_t*>(buffer);
+            mHead = reinterpret_cast<uint32_t*>(base + HEAD_OFFSET);
+            mTail = reinterpret_cast<uint32_t*>(base + TAIL_OFFSET);
+            mData = base + DATA_OFFSET;
+            mMask = uint32_t(capacity - 1);
+        }
+    }
+
+    bool isValid() const noexcept { return mData != nullptr; }
+
+    /**
+     * Calls handler(Command, float const* payload, size_t wordCount) for every command
+     * published since the last call, then hands the storage back to the producer.
+     *
+     * @return the number of commands executed
+     */
+    template<typename HANDLER>
+    size_t drain(HANDLER&& handler) noexcept {
+        if (!mData) {
+            return 0;
+        }
+        uint32_t const head = *mHead;
+        uint32_t tail = *mTail;
+        size_t count = 0;
+        while (tail != head) {
+            uint32_t const index = tail & mMask;
+            uint32_t const header = *reinterpret_cast<uint32_t const*>(mData + index);
+            Command const command = Command(header >> 16u);
+            uint32_t const wordCount = header & 0xFFFFu;
+            if (index + (1 + wordCount) * 4 > mMask + 1) {
+                // corrupted header, drop everything that's pending
+                tail = head;
+                break;
+            }
+            if (command != Command::PADDING) {
+                handler(command, reinterpret_cast<float const*>(mData + index + 4), wordCount);
+                count++;
+            }
+            tail += (1 + wordCount) * 4;
+        }
+        *mTail = tail;
+        return count;
+    }
+
+private:
+    uint32_t* mHead = nullptr;
+    uint32_t* mTail = nullptr;
+    uint8_t* mData = nullptr;
+    uint32_t mMask = 0;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_COMMANDRING_H
@@ -0,0 +1,483 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Etc2Encoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// Intensity modifiers of the color blocks, selectors 0 to 3 pick +a, +b, -a and -b
+constexpr int16_t COLOR_TABLES[8][2] = {
+        { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+// Intensity modifiers of the EAC alpha blocks, scaled by the block's multiplier
+constexpr int16_t ALPHA_TABLES[16][8] = {
+        { -3, -6,  -9, -15, 2, 5, 8, 14 },
+        { -3, -7, -10, -13, 2, 6, 9, 12 },
+        { -2, -5,  -8, -13, 1, 4, 7, 12 },
+        { -2, -4,  -6, -13, 1, 3, 5, 12 },
+        { -3, -6,  -8, -12, 2, 5, 7, 11 },
+        { -3, -7,  -9, -11, 2, 6, 8, 10 },
+        { -4, -7,  -8, -11, 3, 6, 7, 10 },
+        { -3, -5,  -8, -11, 2, 4, 7, 10 },
+        { -2, -6,  -8, -10, 1, 5, 7,  9 },
+        { -2, -5,  -8, -10, 1, 4, 7,  9 },
+        { -2, -4,  -8, -10, 1, 3, 7,  9 },
+        { -2, -5,  -7, -10, 1, 4, 6,  9 },
+        { -3, -4,  -7, -10, 2, 3, 6,  9 },
+        { -1, -2,  -3, -10, 0, 1, 2,  9 },
+        { -4, -6,  -8,  -9, 3, 5, 7,  8 },
+        { -3, -5,  -7,  -9, 2, 4, 6,  8 },
+};
+
+// table 13 is the only one with a null modifier, at index 4
+constexpr uint32_t ALPHA_ZERO_TABLE = 13;
+constexpr uint32_t ALPHA_ZERO_INDEX = 4;
+
+// Pixels are numbered down the columns of a block, as in the selector bits: x * 4 + y.
+using Block = uint8_t[16][4];
+
+// The 8 pixels of a sub-block, laid out for the vector path.
+struct SubBlock {
+    int16_t r[8];
+    int16_t g[8];
+    int16_t b[8];
+    uint8_t pixels[8];
+};
+
+struct Fit {
+    uint32_t error = UINT32_MAX;
+    uint8_t base[3] = {};   // quantized
+    uint8_t table = 0;
+    uint8_t selectors[8] = {};
+};
+
+inline int32_t clamp255(int32_t value) noexcept {
+    return std::min(std::max(value, 0), 255);
+}
+
+inline int32_t expand(int32_t value, int32_t bits) noexcept {
+    return bits == 4 ? (value << 4) | value : (value << 3) | (value >> 2);
+}
+
+inline int32_t quantize(int32_t value, int32_t bits) noexcept {
+    int32_t const max = (1 << bits) - 1;
+    return (value * max + 127) / 255;
+}
+
+// Picks the closest modifier of a table for each pixel, returns the total squared error.
+uint32_t fitTable(SubBlock const& sb, int32_t const color[3], uint32_t table,
+        uint8_t selectors[8]) noexcept {
+    int32_t const a = COLOR_TABLES[table][0];
+    int32_t const b = COLOR_TABLES[table][1];
+    int32_t const modifiers[4] = { a, b, -a, -b };
+    int16_t candidates[4][3];
+    for (size_t m = 0; m < 4; m++) {
+        for (size_t c = 0; c < 3; c++) {
+            candidates[m][c] = int16_t(clamp255(color[c] + modifiers[m]));
+        }
+    }
+
+#if defined(__ARM_NEON)
+    // one pixel per lane, differences fit in 16 bits and their squares in 32
+    int16x8_t const r = vld1q_s16(sb.r);
+    int16x8_t const g = vld1q_s16(sb.g);
+    int16x8_t const bl = vld1q_s16(sb.b);
+    uint32x4_t bestLo = vdupq_n_u32(UINT32_MAX);
+    uint32x4_t bestHi = vdupq_n_u32(UINT32_MAX);
+    uint32x4_t indexLo = vdupq_n_u32(0);
+    uint32x4_t indexHi = vdupq_n_u32(0);
+    for (uint32_t m = 0; m < 4; m++) {
+        int16x8_t const dr = vsubq_s16(r, vdupq_n_s16(candidates[m][0]));
+        int16x8_t const dg = vsubq_s16(g, vdupq_n_s16(candidates[m][1]));
+        int16x8_t const db = vsubq_s16(bl, vdupq_n_s16(candidates[m][2]));
+        int32x4_t lo = vmull_s16(vget_low_s16(dr), vget_low_s16(dr));
+        lo = vmlal_s16(lo, vget_low_s16(dg), vget_low_s16(dg));
+        lo = vmlal_s16(lo, vget_low_s16(db), vget_low_s16(db));
+        int32x4_t hi = vmull_s16(vget_high_s16(dr), vget_high_s16(dr));
+        hi = vmlal_s16(hi, vget_high_s16(dg), vget_high_s16(dg));
+        hi = vmlal_s16(hi, vget_high_s16(db), vget_high_s16(db));
+        // strictly less, the first closest modifier wins as in the scalar loop
+        uint32x4_t const lessLo = vcltq_u32(vreinterpretq_u32_s32(lo), bestLo);
+        uint32x4_t const lessHi = vcltq_u32(vreinterpretq_u32_s32(hi), bestHi);
+        bestLo = vbslq_u32(lessLo, vreinterpretq_u32_s32(lo), bestLo);
+        bestHi = vbslq_u32(lessHi, vreinterpretq_u32_s32(hi), bestHi);
+        indexLo = vbslq_u32(lessLo, vdupq_n_u32(m), indexLo);
+        indexHi = vbslq_u32(lessHi, vdupq_n_u32(m), indexHi);
+    }
+    uint32_t indices[8];
+    vst1q_u32(indices, indexLo);
+    vst1q_u32(indices + 4, indexHi);
+    for (size_t i = 0; i < 8; i++) {
+        selectors[i] = uint8_t(indices[i]);
+    }
+    uint64x2_t const sum = vpaddlq_u32(vaddq_u32(bestLo, bestHi));
+    return uint32_t(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+#else
+    uint32_t total = 0;
+    for (size_t i = 0; i < 8; i++) {
+        uint32_t best = UINT32_MAX;
+        for (uint32_t m = 0; m < 4; m++) {
+            int32_t const dr = sb.r[i] - candidates[m][0];
+            int32_t const dg = sb.g[i] - candidates[m][1];
+            int32_t const db = sb.b[i] - candidates[m][2];
+            uint32_t const error = uint32_t(dr * dr + dg * dg + db * db);
+            if (error < best) {
+                best = error;
+                selectors[i] = uint8_t(m);
+            }
+        }
+        total += best;
+    }
+    return total;
+#endif
+}
+
+// Tries every table with a quantized base color.
+void fitBase(SubBlock const& sb, int32_t const base[3], int32_t bits, Fit& fit) noexcept {
+    int32_t const color[3] = { expand(base[0], bits), expand(base[1], bits),
+            expand(base[2], bits) };
+    uint8_t selectors[8];
+    for (uint32_t table = 0; table < 8 && fit.error; table++) {
+        uint32_t const error = fitTable(sb, color, table, selectors);
+        if (error < fit.error) {
+            fit.error = error;
+            for (size_t c = 0; c < 3; c++) {
+                fit.base[c] = uint8_t(base[c]);
+            }
+            fit.table = uint8_t(table);
+            std::copy(std::begin(selectors), std::end(selectors), fit.selectors);
+        }
+    }
+}
+
+// Fits a sub-block with a base color of the given precision, within [low, high].
+Fit fitSubBlock(SubBlock const& sb, int32_t bits, int32_t const low[3], int32_t const high[3],
+        Etc2Encoder::Quality quality) noexcept {
+    int32_t sum[3] = {};
+    for (size_t i = 0; i < 8; i++) {
+        sum[0] += sb.r[i];
+        sum[1] += sb.g[i];
+        sum[2] += sb.b[i];
+    }
+    int32_t base[3];
+    for (size_t c = 0; c < 3; c++) {
+        base[c] = std::min(std::max(quantize((sum[c] + 4) / 8, bits), low[c]), high[c]);
+    }
+
+    Fit fit;
+    fitBase(sb, base, bits, fit);
+    if (quality == Etc2Encoder::Quality::HIGH) {
+        // one step away on each channel
+        for (size_t c = 0; c < 3; c++) {
+            for (int32_t step : { -1, 1 }) {
+                int32_t neighbor[3] = { base[0], base[1], base[2] };
+                neighbor[c] += step;
+                if (neighbor[c] >= low[c] && neighbor[c] <= high[c]) {
+                    fitBase(sb, neighbor, bits, fit);
+                }
+            }
+        }
+    }
+    return fit;
+}
+
+uint64_t packColorBlock(bool differential, bool flip, Fit const (&fits)[2],
+        SubBlock const (&sb)[2]) noexcept {
+    uint64_t bits = 0;
+    for (uint32_t c = 0; c < 3; c++) {
+        if (differential) {
+            int32_t const delta = int32_t(fits[1].base[c]) - int32_t(fits[0].base[c]);
+            bits |= uint64_t(fits[0].base[c]) << (59 - 8 * c);
+            bits |= uint64_t(delta & 7) << (56 - 8 * c);
+        } else {
+            bits |= uint64_t(fits[0].base[c]) << (60 - 8 * c);
+            bits |= uint64_t(fits[1].base[c]) << (56 - 8 * c);
+        }
+    }
+    bits |= uint64_t(fits[0].table) << 37;
+    bits |= uint64_t(fits[1].table) << 34;
+    bits |= uint64_t(differential) << 33;
+    bits |= uint64_t(flip) << 32;
+    for (size_t s = 0; s < 2; s++) {
+        for (size_t i = 0; i < 8; i++) {
+            uint32_t const pixel = sb[s].pixels[i];
+            uint32_t const selector = fits[s].selectors[i];
+            bits |= uint64_t(selector >> 1) << (16 + pixel);
+            bits |= uint64_t(selector & 1) << pixel;
+        }
+    }
+    return bits;
+}
+
+uint64_t encodeColorBlock(Block const& block, Etc2Encoder::Quality quality) noexcept {
+    uint64_t best = 0;
+    uint32_t bestError = UINT32_MAX;
+    for (uint32_t flip = 0; flip < 2 && bestError; flip++) {
+        // side by side 2x4 sub-blocks, or 4x2 ones on top of each other when flipped
+        SubBlock sb[2];
+        size_t count[2] = {};
+        for (uint32_t pixel = 0; pixel < 16; pixel++) {
+            uint32_t const x = pixel / 4;
+            uint32_t const y = pixel % 4;
+            size_t const s = flip ? y / 2 : x / 2;
+            size_t const i = count[s]++;
+            sb[s].r[i] = block[pixel][0];
+            sb[s].g[i] = block[pixel][1];
+            sb[s].b[i] = block[pixel][2];
+            sb[s].pixels[i] = uint8_t(pixel);
+        }
+
+        int32_t const zero[3] = { 0, 0, 0 };
+        int32_t const max4[3] = { 15, 15, 15 };
+        Fit const individual[2] = {
+                fitSubBlock(sb[0], 4, zero, max4, quality),
+                fitSubBlock(sb[1], 4, zero, max4, quality) };
+        uint32_t error = individual[0].error + individual[1].error;
+        if (error < bestError) {
+            bestError = error;
+            best = packColorBlock(false, flip, individual, sb);
+        }
+
+        // the second base color is a signed 3 bits offset from the first one
+        int32_t const max5[3] = { 31, 31, 31 };
+        Fit const first = fitSubBlock(sb[0], 5, zero, max5, quality);
+        int32_t low[3], high[3];
+        for (size_t c = 0; c < 3; c++) {
+            low[c] = std::max(int32_t(first.base[c]) - 4, 0);
+            high[c] = std::min(int32_t(first.base[c]) + 3, 31);
+        }
+        Fit const differential[2] = { first, fitSubBlock(sb[1], 5, low, high, quality) };
+        error = differential[0].error + differential[1].error;
+        if (error < bestError) {
+            bestError = error;
+            best = packColorBlock(true, flip, differential, sb);
+        }
+    }
+    return best;
+}
+
+uint32_t fitAlpha(Block const& block, int32_t base, int32_t multiplier, uint32_t table,
+        uint8_t selectors[16]) noexcept {
+    int32_t values[8];
+    for (size_t k = 0; k < 8; k++) {
+        values[k] = clamp255(base + ALPHA_TABLES[table][k] * multiplier);
+    }
+    uint32_t total = 0;
+    for (size_t i = 0; i < 16; i++) {
+        uint32_t best = UINT32_MAX;
+        for (uint32_t k = 0; k < 8; k++) {
+            int32_t const d = block[i][3] - values[k];
+            if (uint32_t(d * d) < best) {
+                best = uint32_t(d * d);
+                selectors[i] = uint8_t(k);
+            }
+        }
+        total += best;
+    }
+    return total;
+}
+
+uint64_t packAlphaBlock(int32_t base, int32_t multiplier, uint32_t table,
+        uint8_t const selectors[16]) noexcept {
+    uint64_t bits = uint64_t(base) << 56 | uint64_t(multiplier) << 52 | uint64_t(table) << 48;
+    for (size_t i = 0; i < 16; i++) {
+        bits |= uint64_t(selectors[i]) << (45 - 3 * i);
+    }
+    return bits;
+}
+
+uint64_t encodeAlphaBlock(Block const& block, Etc2Encoder::Quality quality) noexcept {
+    int32_t min = 255;
+    int32_t max = 0;
+    for (size_t i = 0; i < 16; i++) {
+        min = std::min(min, int32_t(block[i][3]));
+        max = std::max(max, int32_t(block[i][3]));
+    }
+    uint8_t selectors[16];
+    if (min == max) {
+        std::fill(std::begin(selectors), std::end(selectors), uint8_t(ALPHA_ZERO_INDEX));
+        return packAlphaBlock(min, 1, ALPHA_ZERO_TABLE, selectors);
+    }
+
+    int32_t const radius = quality == Etc2Encoder::Quality::HIGH ? 2 : 0;
+    uint64_t best = 0;
+    uint32_t bestError = UINT32_MAX;
+    for (uint32_t table = 0; table < 16 && bestError; table++) {
+        // the modifiers span [low, high], scaled to cover [min, max] around their center
+        int32_t const low = ALPHA_TABLES[table][3];
+        int32_t const high = ALPHA_TABLES[table][7];
+        int32_t const range = high - low;
+        int32_t const multiplier = std::min(std::max((max - min + range / 2) / range, 1), 15);
+        int32_t const base = clamp255((min + max - (low + high) * multiplier + 1) / 2);
+        for (int32_t m = std::max(multiplier - radius / 2, 1);
+                m <= std::min(multiplier + radius / 2, 15); m++) {
+            for (int32_t b = std::max(base - radius, 0); b <= std::min(base + radius, 255); b++) {
+                uint32_t const error = fitAlpha(block, b, m, table, selectors);
+                if (error < bestError) {
+                    bestError = error;
+                    best = packAlphaBlock(b, m, table, selectors);
+                }
+            }
+        }
+    }
+    return best;
+}
+
+inline void store(uint64_t bits, uint8_t* out) noexcept {
+    for (size_t i = 0; i < 8; i++) {
+        out[i] = uint8_t(bits >> (56 - 8 * i));
+    }
+}
+
+inline uint64_t load(uint8_t const* in) noexcept {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < 8; i++) {
+        bits = (bits << 8) | in[i];
+    }
+    return bits;
+}
+
+} // anonymous namespace
+
+size_t Etc2Encoder::getEncodedSize(uint32_t width, uint32_t height, bool alpha) noexcept {
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * (alpha ? 16 : 8);
+}
+
+bool Etc2Encoder::isOpaque(uint8_t const* rgba, size_t pixelCount) noexcept {
+    for (size_t i = 0; i < pixelCount; i++) {
+        if (rgba[i * 4 + 3] != 255) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Etc2Encoder::encodeRow(uint8_t const* rgba, uint32_t width, uint32_t height, bool alpha,
+        uint32_t row, uint8_t* out) const noexcept {
+    uint32_t const blockCount = (width + 3) / 4;
+    for (uint32_t bx = 0; bx < blockCount; bx++) {
+        Block block;
+        for (uint32_t pixel = 0; pixel < 16; pixel++) {
+            uint32_t const x = std::min(bx * 4 + pixel / 4, width - 1);
+            uint32_t const y = std::min(row * 4 + pixel % 4, height - 1);
+            std::copy_n(rgba + (size_t(y) * width + x) * 4, 4, block[pixel]);
+        }
+        if (alpha) {
+            store(encodeAlphaBlock(block, mQuality), out);
+            out += 8;
+        }
+        store(encodeColorBlock(block, mQuality), out);
+        out += 8;
+    }
+}
+
+void Etc2Encoder::encode(uint8_t const* rgba, uint32_t width, uint32_t height, bool alpha,
+        uint8_t* out) const {
+    uint32_t const rowCount = (height + 3) / 4;
+    size_t const rowSize = getEncodedSize(width, 4, alpha);
+
+    // each worker takes the next row of blocks until there are none left
+    std::atomic<uint32_t> next{ 0 };
+    auto work = [&]() {
+        for (uint32_t row = next++; row < rowCount; row = next++) {
+            encodeRow(rgba, width, height, alpha, row, out + row * rowSize);
+        }
+    };
+    size_t const threadCount = std::min<size_t>(rowCount,
+            mThreadCount ? mThreadCount : std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threadCount; i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+bool Etc2Encoder::decode(uint8_t const* blocks, uint32_t width, uint32_t height, bool alpha,
+        uint8_t* rgba) noexcept {
+    for (uint32_t by = 0; by < (height + 3) / 4; by++) {
+        for (uint32_t bx = 0; bx < (width + 3) / 4; bx++) {
+            uint8_t alphas[16];
+            std::fill(std::begin(alphas), std::end(alphas), uint8_t(255));
+            if (alpha) {
+                uint64_t const bits = load(blocks);
+                blocks += 8;
+                int32_t const base = int32_t(bits >> 56);
+                int32_t const multiplier = int32_t(bits >> 52) & 15;
+                uint32_t const table = uint32_t(bits >> 48) & 15;
+                for (size_t i = 0; i < 16; i++) {
+                    uint32_t const k = uint32_t(bits >> (45 - 3 * i)) & 7;
+                    alphas[i] = uint8_t(clamp255(base + ALPHA_TABLES[table][k] * multiplier));
+                }
+            }
+
+            uint64_t const bits = load(blocks);
+            blocks += 8;
+            bool const differential = (bits >> 33) & 1;
+            bool const flip = (bits >> 32) & 1;
+            int32_t colors[2][3];
+            for (uint32_t c = 0; c < 3; c++) {
+                if (differential) {
+                    int32_t const first = int32_t(bits >> (59 - 8 * c)) & 31;
+                    // sign extends the 3 bits offset
+                    int32_t const delta = ((int32_t(bits >> (56 - 8 * c)) & 7) ^ 4) - 4;
+                    if (first + delta < 0 || first + delta > 31) {
+                        // T, H or planar block
+                        return false;
+                    }
+                    colors[0][c] = expand(first, 5);
+                    colors[1][c] = expand(first + delta, 5);
+                } else {
+                    colors[0][c] = expand(int32_t(bits >> (60 - 8 * c)) & 15, 4);
+                    colors[1][c] = expand(int32_t(bits >> (56 - 8 * c)) & 15, 4);
+                }
+            }
+            uint32_t const tables[2] = { uint32_t(bits >> 37) & 7, uint32_t(bits >> 34) & 7 };
+
+            for (uint32_t pixel = 0; pixel < 16; pixel++) {
+                uint32_t const x = bx * 4 + pixel / 4;
+                uint32_t const y = by * 4 + pixel % 4;
+                if (x >= width || y >= height) {
+                    continue;
+                }
+                size_t const s = flip ? (pixel % 4) / 2 : (pixel / 4) / 2;
+                uint32_t const selector = uint32_t((bits >> (16 + pixel)) & 1) << 1 |
+                        uint32_t((bits >> pixel) & 1);
+                int32_t const a = COLOR_TABLES[tables[s]][0];
+                int32_t const b = COLOR_TABLES[tables[s]][1];
+                int32_t const modifiers[4] = { a, b, -a, -b };
+                uint8_t* out = rgba + (size_t(y) * width + x) * 4;
+                for (size_t c = 0; c < 3; c++) {
+                    out[c] = uint8_t(clamp255(colors[s][c] + modifiers[selector]));
+                }
+                out[3] = alphas[pixel];
+            }
+        }
+    }
+    return true;
+}
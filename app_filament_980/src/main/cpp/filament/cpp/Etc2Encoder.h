@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_ETC2ENCODER_H
+#define TNT_FILAMENT_SAMPLE_ETC2ENCODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Compresses RGBA8 images to ETC2 at import time, which every GLES 3.0 device samples natively.
+ * Opaque images are encoded as ETC2_RGB8 (4 bits per texel), the others as ETC2_EAC_RGBA8 (8
+ * bits per texel): an EAC alpha block followed by a color block for each 4x4 block. sRGB images
+ * are encoded as is and uploaded with the matching sRGB format.
+ *
+ * Color blocks only use the individual and differential modes, which are common to ETC1 and
+ * ETC2. Rows of blocks are spread over worker threads.
+ */
+class Etc2Encoder {
+public:
+    enum class Quality : uint8_t {
+        FAST,   // base colors are the averages of the sub-blocks
+        HIGH    // base colors are refined around the averages, about 7 times slower
+    };
+
+    void setQuality(Quality quality) noexcept { mQuality = quality; }
+
+    // Number of worker threads, 0 for one per core.
+    void setThreadCount(size_t count) noexcept { mThreadCount = count; }
+
+    // Size of a width x height image once encoded.
+    static size_t getEncodedSize(uint32_t width, uint32_t height, bool alpha) noexcept;
+
+    // Whether the alpha of every pixel is 255, in which case the image can be encoded without it.
+    static bool isOpaque(uint8_t const* rgba, size_t pixelCount) noexcept;
+
+    /**
+     * Encodes an RGBA8 image, its rows are tightly packed. The edges of images whose size isn't
+     * a multiple of 4 are repeated to fill their blocks. out holds getEncodedSize() bytes.
+     */
+    void encode(uint8_t const* rgba, uint32_t width, uint32_t height, bool alpha,
+            uint8_t* out) const;
+
+    /**
+     * Decodes an image produced by encode() back to RGBA8, e.g. to measure the error of an
+     * encoding off-device. Returns false if a block uses a mode encode() doesn't produce.
+     */
+    static bool decode(uint8_t const* blocks, uint32_t width, uint32_t height, bool alpha,
+            uint8_t* rgba) noexcept;
+
+private:
+    // Encodes one row of blocks.
+    void encodeRow(uint8_t const* rgba, uint32_t width, uint32_t height, bool alpha,
+            uint32_t row, uint8_t* out) const noexcept;
+
+    Quality mQuality = Quality::FAST;
+    size_t mThreadCount = 0;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_ETC2ENCODER_H
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameArena.h"
+
+#include "MemoryTracker.h"
+
+#include <utils/memalign.h>
+
+#include <algorithm>
+
+using namespace utils;
+
+FrameArena::Allocator::~Allocator() noexcept {
+    reset();
+}
+
+void* FrameArena::Allocator::overflow(size_t size, size_t alignment) noexcept {
+    // the block's link goes in front of the allocation, padded to keep it aligned
+    size_t const header = std::max(alignment, sizeof(Block));
+    alignment = std::max(alignment, alignof(Block));
+    Block* const block = static_cast<Block*>(utils::aligned_alloc(header + size, alignment));
+    if (!block) {
+        return nullptr;
+    }
+    block->next = mOverflow;
+    mOverflow = block;
+    mOverflowCount++;
+    return pointermath::add(block, header);
+}
+
+void FrameArena::Allocator::reset() noexcept {
+    while (mOverflow) {
+        Block* const next = mOverflow->next;
+        utils::aligned_free(mOverflow);
+        mOverflow = next;
+    }
+    LinearAllocator::reset();
+}
+
+FrameArena::FrameArena(size_t size)
+        : mArenas{ { "FrameArena 0", size }, { "FrameArena 1", size } } {
+    for (Arena const& arena : mArenas) {
+        MemoryTracker::get().track(MemoryTracker::Category::STAGING, &arena,
+                arena.getArea().getSize());
+    }
+}
+
+FrameArena::~FrameArena() {
+    for (Arena const& arena : mArenas) {
+        MemoryTracker::get().untrack(&arena);
+    }
+}
+
+void FrameArena::endFrame() noexcept {
+    mLastUsed = mArenas[mCurrent].getListener().getCurrent();
+    mCurrent ^= 1u;
+    mArenas[mCurrent].reset();
+}
+
+FrameArena::Stats FrameArena::getStats() const noexcept {
+    Stats stats;
+    stats.capacity = mArenas[0].getArea().getSize();
+    stats.used = mLastUsed;
+    for (Arena const& arena : mArenas) {
+        stats.highWatermark = std::max(stats.highWatermark,
+                size_t(arena.getListener().getHighWatermark()));
+        stats.overflows += arena.getAllocator().getOverflowCount();
+    }
+    return stats;
+}
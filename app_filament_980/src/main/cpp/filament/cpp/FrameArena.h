@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_FRAMEARENA_H
+#define TNT_FILAMENT_SAMPLE_FRAMEARENA_H
+
+#include <utils/Allocator.h>
+
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Scratch memory for the render loop: temporary lists of a frame are carved linearly out of an
+ * arena that's reset as a whole, instead of going through malloc.
+ *
+ * There are two arenas used on alternate frames, so that memory allocated during a frame stays
+ * valid until the end of the next one (e.g. for results consumed a frame late). An allocation
+ * that doesn't fit comes from the heap and is freed with its arena, the high watermark tells
+ * how large the arenas should be to avoid this.
+ */
+class FrameArena {
+public:
+    // A LinearAllocator falling back to the heap when it's full.
+    class Allocator : public utils::LinearAllocator {
+    public:
+        template<typename AREA>
+        explicit Allocator(AREA const& area) : LinearAllocator(area) { }
+        ~Allocator() noexcept;
+
+        void* alloc(size_t size, size_t alignment = alignof(std::max_align_t),
+                size_t extra = 0) noexcept {
+            void* const p = LinearAllocator::alloc(size, alignment, extra);
+            return p ? p : overflow(size, alignment);
+        }
+
+        void reset() noexcept;
+
+        uint32_t getOverflowCount() const noexcept { return mOverflowCount; }
+
+    private:
+        struct Block {
+            Block* next;
+        };
+
+        void* overflow(size_t size, size_t alignment) noexcept;
+
+        Block* mOverflow = nullptr;
+        uint32_t mOverflowCount = 0;
+    };
+
+    // HighWatermark counting every allocation until the arena is reset, as a linear arena
+    // doesn't get memory back before that.
+    struct Tracker : public utils::TrackingPolicy::HighWatermark {
+        using HighWatermark::HighWatermark;
+        void onFree(void*, size_t = 0) noexcept { }
+        uint32_t getCurrent() const noexcept { return mCurrent; }
+        uint32_t getHighWatermark() const noexcept { return mHighWaterMark; }
+    };
+
+    using Arena = utils::Arena<Allocator, utils::LockingPolicy::NoLock, Tracker>;
+
+    template<typename T>
+    using vector = std::vector<T, utils::STLAllocator<T, Arena>>;
+
+    struct Stats {
+        size_t capacity = 0;        // of each arena
+        size_t used = 0;            // by the last frame
+        size_t highWatermark = 0;   // of all frames so far
+        uint32_t overflows = 0;     // allocations that came from the heap so far
+    };
+
+    // size is the capacity of each of the two arenas.
+    explicit FrameArena(size_t size);
+    ~FrameArena();
+
+    FrameArena(FrameArena const&) = delete;
+    FrameArena& operator=(FrameArena const&) = delete;
+
+    // The arena of the current frame.
+    Arena& get() noexcept { return mArenas[mCurrent]; }
+
+    template<typename T>
+    vector<T> makeVector() { return vector<T>(get()); }
+
+    // Switches to the other arena and resets it, what the frame before allocated is now gone.
+    void endFrame() noexcept;
+
+    Stats getStats() const noexcept;
+
+private:
+    Arena mArenas[2];
+    uint8_t mCurrent = 0;
+    size_t mLastUsed = 0;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_FRAMEARENA_H
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FramePacer.h"
+
+#include <filament/Renderer.h>
+
+#include <algorithm>
+
+using namespace filament;
+
+// the interval goes up when more than this fraction of the window misses the current interval
+static constexpr float DOWNSHIFT_SLOW_FRACTION = 0.1f;
+// and comes back down when no more than this fraction would miss 80% of the shorter interval
+static constexpr float UPSHIFT_SLOW_FRACTION = 0.02f;
+static constexpr float UPSHIFT_MARGIN = 0.8f;
+// frames to hold an interval before shortening it
+static constexpr uint32_t UPSHIFT_DWELL_FRAMES = 240;
+
+FramePacer::FramePacer(Renderer& renderer) noexcept : mRenderer(renderer) {
+}
+
+void FramePacer::setDisplayInfo(float refreshRate, uint64_t presentationDeadlineNanos,
+        uint64_t vsyncOffsetNanos) noexcept {
+    mRefreshRate = refreshRate > 0.0f ? refreshRate : 60.0f;
+    Renderer::DisplayInfo info;
+    info.refreshRate = mRefreshRate;
+    info.presentationDeadlineNanos = presentationDeadlineNanos;
+    info.vsyncOffsetNanos = vsyncOffsetNanos;
+    mRenderer.setDisplayInfo(info);
+    // the frame costs measured so far don't say much about the new refresh rate
+    mWindow = {};
+    mHistogram = {};
+    mWindowCount = 0;
+    mWindowIndex = 0;
+    setInterval(1);
+}
+
+void FramePacer::setMaxInterval(uint8_t interval) noexcept {
+    mMaxInterval = std::max(interval, uint8_t(1));
+    if (mInterval > mMaxInterval) {
+        setInterval(mMaxInterval);
+    }
+}
+
+void FramePacer::setInterval(uint8_t interval) noexcept {
+    mInterval = interval;
+    mFramesSinceChange = 0;
+    Renderer::FrameRateOptions options;
+    options.interval = interval;
+    mRenderer.setFrameRateOptions(options);
+}
+
+bool FramePacer::beginFrame(uint64_t vsyncNanos) noexcept {
+    if (mDuePending) {
+        // the last frame due wasn't drawn (nothing changed, or the renderer dropped it), the
+        // next gap says nothing about jank
+        mDrawnInARow = false;
+    }
+    mVsync = vsyncNanos;
+    // half a period of slack for the jitter of the vsync timestamps, which are in nanoseconds
+    double const period = 1e9 / mRefreshRate;
+    mDuePending = !mLastDrawnVsync ||
+            double(vsyncNanos - mLastDrawnVsync) >= (mInterval - 0.5) * period;
+    return mDuePending;
+}
+
+void FramePacer::endFrame(float frameTimeMs) noexcept {
+    if (mDrawnInARow) {
+        // vsyncs went by without a callback, the previous frame was shown for too long
+        double const period = 1e9 / mRefreshRate;
+        if (double(mVsync - mLastDrawnVsync) >= (mInterval + 0.5) * period) {
+            mStats.janks++;
+        }
+    }
+    mLastDrawnVsync = mVsync;
+    mDrawnInARow = true;
+    mDuePending = false;
+
+    mStats.frames++;
+    mFramesSinceChange++;
+
+    size_t const bucket = std::min(size_t(frameTimeMs / BUCKET_WIDTH_MS), BUCKET_COUNT - 1);
+    if (mWindowCount == WINDOW_SIZE) {
+        float const evicted = mWindow[mWindowIndex];
+        mHistogram[std::min(size_t(evicted / BUCKET_WIDTH_MS), BUCKET_COUNT - 1)]--;
+    } else {
+        mWindowCount++;
+    }
+    mWindow[mWindowIndex] = frameTimeMs;
+    mHistogram[bucket]++;
+    mWindowIndex = (mWindowIndex + 1) % WINDOW_SIZE;
+
+    if (mWindowCount < WINDOW_SIZE / 4) {
+        return;
+    }
+
+    float const periodMs = getPeriodMs();
+    if (mInterval < mMaxInterval && getSlowFraction(mInterval * periodMs) > DOWNSHIFT_SLOW_FRACTION) {
+        setInterval(mInterval + 1);
+    } else if (mInterval > 1 && mFramesSinceChange >= UPSHIFT_DWELL_FRAMES &&
+            getSlowFraction((mInterval - 1) * periodMs * UPSHIFT_MARGIN) <= UPSHIFT_SLOW_FRACTION) {
+        setInterval(mInterval - 1);
+    }
+}
+
+float FramePacer::getSlowFraction(float budgetMs) const noexcept {
+    // frames in the bucket holding the budget are counted as slow, which errs on the safe side
+    size_t const first = std::min(size_t(budgetMs / BUCKET_WIDTH_MS), BUCKET_COUNT - 1);
+    uint32_t slow = 0;
+    for (size_t i = first; i < BUCKET_COUNT; i++) {
+        slow += mHistogram[i];
+    }
+    return float(slow) / float(mWindowCount);
+}
+
+FramePacer::Stats FramePacer::resetStats() noexcept {
+    Stats stats = mStats;
+    stats.interval = mInterval;
+    mStats = {};
+    return stats;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_FRAMEPACER_H
+#define TNT_FILAMENT_SAMPLE_FRAMEPACER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+
+namespace filament {
+class Renderer;
+}
+
+/**
+ * Picks the frame interval, in display refresh periods, that the frame cost can sustain, and
+ * skips the vsyncs in between. On a 120 Hz panel, a scene that costs 12 ms is better shown at a
+ * steady 60 Hz than at an erratic 70-100 Hz.
+ *
+ * The cost of the recent frames is kept in a rolling histogram. The interval goes up as soon as
+ * the slow frames exceed a small fraction of the window, and only comes back down once the
+ * whole window fits comfortably in the shorter interval and the current interval has been held
+ * for a while, so that it doesn't oscillate around a threshold.
+ *
+ * The interval and the display properties are forwarded to the Renderer, which uses them for its
+ * own pacing and dynamic resolution.
+ */
+class FramePacer {
+public:
+    struct Stats {
+        uint32_t frames = 0;
+        uint32_t janks = 0;     // frames presented later than the interval allows
+        uint8_t interval = 1;
+    };
+
+    explicit FramePacer(filament::Renderer& renderer) noexcept;
+
+    void setDisplayInfo(float refreshRate, uint64_t presentationDeadlineNanos,
+            uint64_t vsyncOffsetNanos) noexcept;
+
+    void setMaxInterval(uint8_t interval) noexcept;
+
+    /**
+     * Called on every vsync with its timestamp (steady clock, e.g. Choreographer's frame time).
+     * Returns false if this vsync falls within the current interval and shouldn't be drawn.
+     */
+    bool beginFrame(uint64_t vsyncNanos) noexcept;
+
+    // Only called when the frame was drawn, with its cost, e.g. the larger of its CPU and GPU
+    // times.
+    void endFrame(float frameTimeMs) noexcept;
+
+    uint8_t getInterval() const noexcept { return mInterval; }
+
+    // Returns the counters accumulated since the last call and resets them.
+    Stats resetStats() noexcept;
+
+private:
+    static constexpr size_t WINDOW_SIZE = 120;
+    static constexpr size_t BUCKET_COUNT = 64;
+    static constexpr float BUCKET_WIDTH_MS = 0.5f;
+
+    float getPeriodMs() const noexcept { return 1000.0f / mRefreshRate; }
+    // Fraction of the window that took longer than budgetMs.
+    float getSlowFraction(float budgetMs) const noexcept;
+    void setInterval(uint8_t interval) noexcept;
+
+    filament::Renderer& mRenderer;
+    float mRefreshRate = 60.0f;
+    uint8_t mInterval = 1;
+    uint8_t mMaxInterval = 4;
+    uint32_t mFramesSinceChange = 0;
+
+    std::array<float, WINDOW_SIZE> mWindow{};
+    std::array<uint16_t, BUCKET_COUNT> mHistogram{};
+    size_t mWindowCount = 0;
+    size_t mWindowIndex = 0;
+
+    uint64_t mVsync = 0;
+    uint64_t mLastDrawnVsync = 0;
+    bool mDuePending = false;
+    bool mDrawnInARow = false;
+    Stats mStats;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_FRAMEPACER_H
@@ -20,9 +20,6 @@
 #include <string>
 #include <iostream>
 
-#include <android/asset_manager.h>
-#include <android/asset_manager_jni.h>
-
 #include <filament/Engine.h>
 #include <filament/IndexBuffer.h>
 #include <filament/IndirectLight.h>
@@ -33,6 +30,10 @@
 
 #include "stb_image.h"
 
+#include "MemoryTracker.h"
+#include "PixelBufferPool.h"
+
+#include "../../android/AssetSource.h"
 #include "../../android/Path.h"
 
 using namespace filament;
@@ -43,19 +44,21 @@ IBL::IBL(Engine& engine) : mEngine(engine) {
 }
 
 IBL::~IBL() {
+    MemoryTracker::get().untrack(mTexture);
+    MemoryTracker::get().untrack(mSkyboxTexture);
     mEngine.destroy(mIndirectLight);
     mEngine.destroy(mTexture);
     mEngine.destroy(mSkybox);
     mEngine.destroy(mSkyboxTexture);
 }
 
-bool IBL::loadFromDirectory(AAssetManager *assetManager, const utils::Path& path) {
+bool IBL::loadFromDirectory(AssetSource const& source, const utils::Path& path) {
     // Read spherical harmonics
     Path sh(Path::concat(path, "sh.txt"));
-    AAsset* asset = AAssetManager_open(assetManager, sh.getPath().c_str(), AASSET_MODE_RANDOM);
-    if (asset) {
-        const void* buf = AAsset_getBuffer(asset);
-        off_t size = AAsset_getLength(asset);
+    {
+        AssetSource::Asset asset = source.open(sh);
+        const void* buf = asset.getData();
+        size_t size = asset.getSize();
         if (buf) {
             struct membuf : std::streambuf {
                 membuf(char *base, std::ptrdiff_t n) {
@@ -74,21 +77,20 @@ bool IBL::loadFromDirectory(AAssetManager *assetManager, const utils::Path& path
                     return false;
             }
         }
-        AAsset_close(asset);
     }
 
     // Read mip-mapped cubemap
-    if (!loadCubemapLevel(&mTexture, assetManager, path, 0, "m0_")) return false;
+    if (!loadCubemapLevel(&mTexture, source, path, 0, "m0_")) return false;
 
     size_t numLevels = mTexture->getLevels();
     for (size_t i = 1; i<numLevels; i++) {
         std::string levelPrefix = "m";
         levelPrefix += std::to_string(i) + "_";
-        if (!loadCubemapLevel(&mTexture, assetManager, path, i, levelPrefix))
+        if (!loadCubemapLevel(&mTexture, source, path, i, levelPrefix))
             return false;
     }
 
-    if (!loadCubemapLevel(&mSkyboxTexture, assetManager, path)) return false;
+    if (!loadCubemapLevel(&mSkyboxTexture, source, path)) return false;
 
     mIndirectLight = IndirectLight::Builder()
             .reflections(mTexture)
@@ -102,7 +104,7 @@ bool IBL::loadFromDirectory(AAssetManager *assetManager, const utils::Path& path
 }
 
 bool IBL::loadCubemapLevel(filament::Texture **texture,
-                           AAssetManager *assetManager, const utils::Path &path, size_t level,
+                           AssetSource const& source, const utils::Path &path, size_t level,
                            std::string const &levelPrefix) const {
     static const char* faceSuffix[6] = { "px", "nx", "py", "ny", "pz", "nz" };
 
@@ -114,16 +116,14 @@ bool IBL::loadCubemapLevel(filament::Texture **texture,
         std::string faceName = levelPrefix + faceSuffix[0] + ".rgbm";
         Path facePath(Path::concat(path, faceName));
 
-        AAsset* asset = AAssetManager_open(assetManager, facePath.getPath().c_str(), AASSET_MODE_RANDOM);
-        if (!asset) {
+        AssetSource::Asset asset = source.open(facePath);
+        if (!asset.getData()) {
             std::cerr << "The face " << faceName << " does not exist" << std::endl;
             return false;
         }
 
-        const void *buf = AAsset_getBuffer(asset);
-        off_t len = AAsset_getLength(asset);
-        stbi_info_from_memory((const stbi_uc *) buf, (int) len, &w, &h, nullptr);
-        AAsset_close(asset);
+        stbi_info_from_memory((const stbi_uc *) asset.getData(), (int) asset.getSize(),
+                &w, &h, nullptr);
 
         if (w != h) {
             std::cerr << "with != height" << std::endl;
@@ -143,6 +143,8 @@ bool IBL::loadCubemapLevel(filament::Texture **texture,
                     .format(Texture::InternalFormat::UNUSED)
                     .sampler(Texture::Sampler::SAMPLER_CUBEMAP)
                     .build(mEngine);
+            MemoryTracker::get().track(MemoryTracker::Category::ENVIRONMENT, *texture,
+                    MemoryTracker::getTextureSize(*texture));
         }
     }
 
@@ -151,10 +153,16 @@ bool IBL::loadCubemapLevel(filament::Texture **texture,
     const size_t faceSize = size * size * 4;
 
     Texture::FaceOffsets offsets;
+    PixelBufferPool& pool = PixelBufferPool::get();
     Texture::PixelBufferDescriptor buffer(
-            malloc(faceSize * 6), faceSize * 6,
+            pool.alloc(faceSize * 6), faceSize * 6,
             Texture::Format::UNUSED, Texture::Type::UBYTE,
-            (Texture::PixelBufferDescriptor::Callback) &free);
+            &PixelBufferPool::release, &pool);
+
+    if (!buffer.buffer) {
+        std::cerr << "Out of memory for a level of " << size << " x " << size << std::endl;
+        return false;
+    }
 
     bool success = true;
     uint8_t* p = static_cast<uint8_t*>(buffer.buffer);
@@ -165,28 +173,28 @@ bool IBL::loadCubemapLevel(filament::Texture **texture,
         std::string faceName = levelPrefix + faceSuffix[j] + ".rgbm";
         Path facePath(Path::concat(path, faceName));
 
-        AAsset* asset = AAssetManager_open(assetManager, facePath.getPath().c_str(), AASSET_MODE_RANDOM);
-        if (!asset) {
+        AssetSource::Asset asset = source.open(facePath);
+        if (!asset.getData()) {
             std::cerr << "The face " << faceName << " does not exist" << std::endl;
             success = false;
             break;
         }
 
         int w, h, n;
-        const void *buf = AAsset_getBuffer(asset);
-        off_t len = AAsset_getLength(asset);
-        unsigned char* data = stbi_load_from_memory((const stbi_uc *)buf, (int)len, &w, &h, &n, 4);
-        AAsset_close(asset);
+        unsigned char* data = stbi_load_from_memory((const stbi_uc *) asset.getData(),
+                (int) asset.getSize(), &w, &h, &n, 4);
 
         if (w != h || w != size) {
             std::cerr << "Face " << faceName << "has a wrong size " << w << " x " << h <<
                     ", instead of " << size << " x " << size << std::endl;
+            stbi_image_free(data);
             success = false;
             break;
         }
 
         if (data == nullptr || n != 4) {
             std::cerr << "Could not decode face " << faceName << std::endl;
+            stbi_image_free(data);
             success = false;
             break;
         }
@@ -201,5 +209,10 @@ bool IBL::loadCubemapLevel(filament::Texture **texture,
     return true;
 }
 
+// Decoded images and the decoder's scratch memory are recycled by the pixel buffer pool, an
+// image can be handed to the engine as is with stbi_image_free as its callback
+#define STBI_MALLOC(size)       PixelBufferPool::get().allocTagged(size)
+#define STBI_REALLOC(p, size)   PixelBufferPool::get().reallocTagged(p, size)
+#define STBI_FREE(p)            PixelBufferPool::get().freeTagged(p)
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
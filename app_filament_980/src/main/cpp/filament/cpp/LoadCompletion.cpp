@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LoadCompletion.h"
+
+using namespace filament;
+using namespace utils;
+
+LoadCompletion* LoadCompletion::create(AssetSource::Asset&& asset) {
+    return new LoadCompletion(std::move(asset));
+}
+
+LoadCompletion::LoadCompletion(AssetSource::Asset&& asset) noexcept : mAsset(std::move(asset)) {
+}
+
+backend::BufferDescriptor LoadCompletion::makeDescriptor(void const* data, size_t size) {
+    mPending.fetch_add(1, std::memory_order_relaxed);
+    mReferences.fetch_add(1, std::memory_order_relaxed);
+    return backend::BufferDescriptor(data, size, &LoadCompletion::onBufferReleased, this);
+}
+
+void LoadCompletion::onBufferReleased(void*, size_t, void* user) {
+    LoadCompletion* completion = static_cast<LoadCompletion*>(user);
+    completion->retire();
+    completion->release();
+}
+
+void LoadCompletion::seal() noexcept {
+    retire();
+}
+
+void LoadCompletion::retire() noexcept {
+    if (mPending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // the caller still holds a reference, so this can't race with the destruction
+        mAsset = {};
+    }
+}
+
+void LoadCompletion::release() noexcept {
+    if (mReferences.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this;
+    }
+}
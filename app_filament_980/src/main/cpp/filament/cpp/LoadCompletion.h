@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_LOADCOMPLETION_H
+#define TNT_FILAMENT_SAMPLE_LOADCOMPLETION_H
+
+#include "../../android/AssetSource.h"
+
+#include <backend/BufferDescriptor.h>
+
+#include <atomic>
+
+/**
+ * Tracks the buffers a load operation hands to the engine, so that the loader can return right
+ * away instead of waiting on a fence. The asset they point into is kept open until the engine
+ * releases the last of them, at which point the load is complete.
+ *
+ * Reference counted: the loader holds one reference, and every descriptor holds another until
+ * its callback runs on the driver thread.
+ */
+class LoadCompletion {
+public:
+    static LoadCompletion* create(utils::AssetSource::Asset&& asset);
+
+    // Returns a descriptor for data (which should point into the asset) tracked by this load.
+    filament::backend::BufferDescriptor makeDescriptor(void const* data, size_t size);
+
+    // Must be called once every descriptor has been made, the load can't complete before that.
+    void seal() noexcept;
+
+    bool isComplete() const noexcept {
+        return mPending.load(std::memory_order_acquire) == 0;
+    }
+
+    // Drops the caller's reference.
+    void release() noexcept;
+
+private:
+    explicit LoadCompletion(utils::AssetSource::Asset&& asset) noexcept;
+    ~LoadCompletion() noexcept = default;
+
+    static void onBufferReleased(void* buffer, size_t size, void* user);
+    void retire() noexcept;
+
+    utils::AssetSource::Asset mAsset;
+    // descriptors still in use by the engine, plus one until seal()
+    std::atomic<uint32_t> mPending{ 1 };
+    std::atomic<uint32_t> mReferences{ 1 };
+};
+
+#endif // TNT_FILAMENT_SAMPLE_LOADCOMPLETION_H
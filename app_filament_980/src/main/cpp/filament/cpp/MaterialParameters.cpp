@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MaterialParameters.h"
+
+#include <string.h>
+
+using namespace filament;
+using namespace filament::math;
+
+MaterialParameters::MaterialParameters(Material const* material) {
+    std::vector<Material::ParameterInfo> infos(material->getParameterCount());
+    infos.resize(material->getParameters(infos.data(), infos.size()));
+    for (Material::ParameterInfo const& info : infos) {
+        // samplers need a texture and a TextureSampler, they're set directly
+        if (!info.isSampler && mParameters.size() < INVALID) {
+            mParameters.push_back({ info.name, info.type });
+        }
+    }
+}
+
+MaterialParameters::Handle MaterialParameters::getHandle(const char* name) const noexcept {
+    for (size_t i = 0, c = mParameters.size(); i < c; i++) {
+        if (!strcmp(mParameters[i].name, name)) {
+            return Handle(i);
+        }
+    }
+    return INVALID;
+}
+
+bool MaterialParameters::changed(MaterialInstance const* mi, Handle handle,
+        float4 const& value) noexcept {
+    std::vector<ShadowValue>& shadow = mShadows[mi];
+    if (shadow.empty()) {
+        shadow.resize(mParameters.size(), { float4{}, false });
+    }
+    ShadowValue& last = shadow[handle];
+    // compared bitwise so that a NaN being set again is still recognized as unchanged
+    if (last.valid && !memcmp(&last.value, &value, sizeof(float4))) {
+        mStats.skipped++;
+        return false;
+    }
+    last = { value, true };
+    mStats.updates++;
+    return true;
+}
+
+void MaterialParameters::apply(MaterialInstance* const* instances, size_t instanceCount,
+        Update const* updates, size_t count) noexcept {
+    Parameter const* const parameters = mParameters.data();
+    size_t const parameterCount = mParameters.size();
+    for (size_t i = 0; i < count; i++) {
+        Update const& update = updates[i];
+        if (update.handle >= parameterCount || update.instance >= instanceCount) {
+            continue;
+        }
+        Parameter const& parameter = parameters[update.handle];
+        MaterialInstance* const mi = instances[update.instance];
+        float const* v = update.value;
+        switch (parameter.type) {
+            case Material::ParameterType::FLOAT:
+                setFloat(mi, update.handle, { v[0], 0, 0, 0 }, v[0]);
+                break;
+            case Material::ParameterType::FLOAT2:
+                setFloat(mi, update.handle, { v[0], v[1], 0, 0 }, float2{ v[0], v[1] });
+                break;
+            case Material::ParameterType::FLOAT3:
+                setFloat(mi, update.handle, { v[0], v[1], v[2], 0 }, float3{ v[0], v[1], v[2] });
+                break;
+            case Material::ParameterType::FLOAT4: {
+                float4 const value{ v[0], v[1], v[2], v[3] };
+                setFloat(mi, update.handle, value, value);
+                break;
+            }
+            default:
+                // only float parameters can be batched
+                break;
+        }
+    }
+}
+
+void MaterialParameters::forget(MaterialInstance const* mi) noexcept {
+    mShadows.erase(mi);
+}
+
+MaterialParameters::Stats MaterialParameters::resetStats() noexcept {
+    Stats const stats = mStats;
+    mStats = {};
+    return stats;
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_MATERIALPARAMETERS_H
+#define TNT_FILAMENT_SAMPLE_MATERIALPARAMETERS_H
+
+#include <filament/Material.h>
+#include <filament/MaterialInstance.h>
+
+#include <math/vec2.h>
+#include <math/vec3.h>
+#include <math/vec4.h>
+
+#include <tsl/robin_map.h>
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Uniform parameters of a Material, resolved once so that instances can be updated through
+ * compact handles. MaterialInstance only takes names, so the engine still looks the name of a
+ * handle up when a value reaches it; what handles buy is the shadow copy described below, which
+ * keeps most values from reaching it at all.
+ *
+ * Parameters the material doesn't declare resolve to INVALID and setting them is a no-op, which
+ * avoids the engine's error path for shared code driving several materials.
+ *
+ * Float parameters set through this class are also shadowed per instance: setting the value an
+ * instance already has is skipped, so that it doesn't dirty the instance's uniform buffer.
+ * Values set directly on the MaterialInstance are not seen by the shadow copy.
+ */
+class MaterialParameters {
+public:
+    using Handle = uint16_t;
+    static constexpr Handle INVALID = 0xFFFF;
+
+    // One packed update for apply(), only the first components of value are used, depending on
+    // the type of the parameter.
+    struct Update {
+        uint32_t instance;  // index in the instances array given to apply()
+        Handle handle;
+        float value[4];
+    };
+
+    struct Stats {
+        uint32_t updates = 0;   // setParameter calls forwarded to the engine
+        uint32_t skipped = 0;   // calls suppressed because the value didn't change
+    };
+
+    MaterialParameters() noexcept = default;
+    explicit MaterialParameters(filament::Material const* material);
+
+    Handle getHandle(const char* name) const noexcept;
+
+    // Sets a single parameter, T must match the type declared by the material.
+    template<typename T>
+    void set(filament::MaterialInstance* mi, Handle handle, T value) noexcept {
+        if (handle < mParameters.size()) {
+            mi->setParameter(mParameters[handle].name, value);
+            mStats.updates++;
+        }
+    }
+
+    void set(filament::MaterialInstance* mi, Handle handle, float value) noexcept {
+        setFloat(mi, handle, { value, 0, 0, 0 }, value);
+    }
+
+    void set(filament::MaterialInstance* mi, Handle handle, filament::math::float2 value) noexcept {
+        setFloat(mi, handle, { value, 0, 0 }, value);
+    }
+
+    void set(filament::MaterialInstance* mi, Handle handle, filament::math::float3 value) noexcept {
+        setFloat(mi, handle, { value, 0 }, value);
+    }
+
+    void set(filament::MaterialInstance* mi, Handle handle, filament::math::float4 value) noexcept {
+        setFloat(mi, handle, value, value);
+    }
+
+    // Applies count float/floatN updates to any of the given instances of this material.
+    void apply(filament::MaterialInstance* const* instances, size_t instanceCount,
+            Update const* updates, size_t count) noexcept;
+
+    // Drops the shadow copy of an instance, must be called before it's destroyed.
+    void forget(filament::MaterialInstance const* mi) noexcept;
+
+    // Returns the counters accumulated since the last call and resets them.
+    Stats resetStats() noexcept;
+
+    size_t getCount() const noexcept { return mParameters.size(); }
+
+private:
+    struct Parameter {
+        const char* name;   // owned by the material
+        filament::Material::ParameterType type;
+    };
+
+    struct ShadowValue {
+        filament::math::float4 value;
+        bool valid;
+    };
+
+    template<typename T>
+    void setFloat(filament::MaterialInstance* mi, Handle handle,
+            filament::math::float4 const& shadow, T value) noexcept {
+        if (handle < mParameters.size() && changed(mi, handle, shadow)) {
+            mi->setParameter(mParameters[handle].name, value);
+        }
+    }
+
+    // Records value as the last one set and returns whether it differs from the previous one.
+    bool changed(filament::MaterialInstance const* mi, Handle handle,
+            filament::math::float4 const& value) noexcept;
+
+    std::vector<Parameter> mParameters;
+    tsl::robin_map<filament::MaterialInstance const*, std::vector<ShadowValue>> mShadows;
+    Stats mStats;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_MATERIALPARAMETERS_H
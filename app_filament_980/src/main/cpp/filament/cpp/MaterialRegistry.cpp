@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MaterialRegistry.h"
+
+#include "MemoryTracker.h"
+
+#include <filament/Engine.h>
+#include <filament/Material.h>
+#include <filament/MaterialInstance.h>
+
+#include <utils/Hash.h>
+
+#include <algorithm>
+#include <string.h>
+
+using namespace filament;
+using namespace filamat;
+using namespace utils;
+
+MaterialRegistry::MaterialRegistry(Engine& engine) : mEngine(engine) {
+}
+
+MaterialRegistry::~MaterialRegistry() {
+    for (MaterialInstance* mi : mInstances) {
+        mEngine.destroy(mi);
+    }
+    for (Material* material : mMaterials) {
+        MemoryTracker::get().untrack(material);
+        mEngine.destroy(material);
+    }
+}
+
+Package const* MaterialRegistry::getPackage(std::string const& name, PackageBuilder builder) {
+    // Intentionally leaked: packages must outlive every registry, as the engine does.
+    // Boxed, the map moves its values around when it grows.
+    static auto& sPackages = *new tsl::robin_map<std::string, std::unique_ptr<Package>>();
+
+    auto iter = sPackages.find(name);
+    if (iter == sPackages.end()) {
+        auto package = std::make_unique<Package>(builder());
+        if (!package->isValid()) {
+            return nullptr;
+        }
+        iter = sPackages.emplace(name, std::move(package)).first;
+        MemoryTracker::get().track(MemoryTracker::Category::MATERIALS, iter->second.get(),
+                iter->second->getSize());
+    }
+    return iter->second.get();
+}
+
+uint32_t MaterialRegistry::hashPackage(void const* data, size_t size) noexcept {
+    // murmur3 works on whole words, the trailing bytes (if any) are folded into the seed
+    uint32_t tail = 0;
+    memcpy(&tail, (uint8_t const*) data + (size & ~size_t(3)), size & 3u);
+    uint32_t const seed = uint32_t(size) ^ tail;
+    size_t const wordCount = size / 4;
+    if (wordCount == 0) {
+        return seed;
+    }
+    // packages are heap allocated, hence suitably aligned for word reads
+    return hash::murmur3((uint32_t const*) data, wordCount, seed);
+}
+
+Material const* MaterialRegistry::getMaterial(void const* data, size_t size) {
+    auto& bucket = mCache[hashPackage(data, size)];
+    for (Entry const& entry : bucket) {
+        if (entry.package.size() == size && !memcmp(entry.package.data(), data, size)) {
+            return entry.material;
+        }
+    }
+
+    Material* material = Material::Builder().package(data, size).build(mEngine);
+    if (!material) {
+        return nullptr;
+    }
+    uint8_t const* bytes = (uint8_t const*) data;
+    bucket.push_back({ std::vector<uint8_t>(bytes, bytes + size), material });
+    // the copy of the package kept to identify it
+    MemoryTracker::get().track(MemoryTracker::Category::MATERIALS, material, size);
+    mMaterials.push_back(material);
+    return material;
+}
+
+MaterialParameters& MaterialRegistry::getParameters(Material const* material) {
+    auto iter = mParameters.find(material);
+    if (iter == mParameters.end()) {
+        iter = mParameters.emplace(material, std::make_unique<MaterialParameters>(material)).first;
+    }
+    return *iter->second;
+}
+
+MaterialParameters::Stats MaterialRegistry::resetStats() noexcept {
+    MaterialParameters::Stats total;
+    for (auto& iter : mParameters) {
+        MaterialParameters::Stats const stats = iter.second->resetStats();
+        total.updates += stats.updates;
+        total.skipped += stats.skipped;
+    }
+    return total;
+}
+
+MaterialInstance* MaterialRegistry::createInstance(Material const* material, const char* name) {
+    MaterialInstance* mi = material->createInstance(name);
+    mInstances.push_back(mi);
+    return mi;
+}
+
+void MaterialRegistry::destroyInstance(MaterialInstance* mi) {
+    auto iter = std::find(mInstances.begin(), mInstances.end(), mi);
+    if (iter != mInstances.end()) {
+        auto parameters = mParameters.find(mi->getMaterial());
+        if (parameters != mParameters.end()) {
+            parameters->second->forget(mi);
+        }
+        mInstances.erase(iter);
+        mEngine.destroy(mi);
+    }
+}
+
+MaterialInstance* MaterialRegistry::acquireInstance(Material const* material) {
+    auto iter = mPools.find(material);
+    if (iter != mPools.end() && !iter->second.free.empty()) {
+        std::vector<MaterialInstance*>& free = iter.value().free;
+        MaterialInstance* mi = free.back();
+        free.pop_back();
+        return mi;
+    }
+    return createInstance(material);
+}
+
+void MaterialRegistry::releaseInstance(MaterialInstance* mi) {
+    if (std::find(mInstances.begin(), mInstances.end(), mi) == mInstances.end()) {
+        // adopted, so that it's destroyed along with the others
+        mInstances.push_back(mi);
+    }
+    Material const* material = mi->getMaterial();
+    Pool& pool = mPools[material];
+    if (pool.free.size() >= mPoolHighWaterMark) {
+        destroyInstance(mi);
+        return;
+    }
+    if (!pool.defaults.empty()) {
+        // every update targets instance 0, i.e. mi
+        getParameters(material).apply(&mi, 1, pool.defaults.data(), pool.defaults.size());
+    }
+    pool.free.push_back(mi);
+}
+
+void MaterialRegistry::setPoolDefaults(Material const* material,
+        std::vector<MaterialParameters::Update> defaults) {
+    for (MaterialParameters::Update& update : defaults) {
+        update.instance = 0;
+    }
+    mPools[material].defaults = std::move(defaults);
+}
+
+void MaterialRegistry::setPoolHighWaterMark(size_t count) {
+    mPoolHighWaterMark = count;
+    for (auto iter = mPools.begin(); iter != mPools.end(); ++iter) {
+        std::vector<MaterialInstance*>& free = iter.value().free;
+        while (free.size() > count) {
+            destroyInstance(free.back());
+            free.pop_back();
+        }
+    }
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_MATERIALREGISTRY_H
+#define TNT_FILAMENT_SAMPLE_MATERIALREGISTRY_H
+
+#include "MaterialParameters.h"
+
+#include <filamat/Package.h>
+
+#include <tsl/robin_map.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace filament {
+class Engine;
+class Material;
+class MaterialInstance;
+}
+
+/**
+ * Builds each distinct material package into a single filament::Material and hands out instances
+ * of it. Packages are identified by content, so building the same package several times returns
+ * the same Material.
+ *
+ * Compiled packages are additionally cached for the lifetime of the process, which lets the
+ * engine (kept between activity launches) skip the MaterialBuilder step on every init().
+ *
+ * Instances can also be pooled per material: acquireInstance() recycles an instance previously
+ * given back with releaseInstance(), which first resets it to the pool's default values.
+ */
+class MaterialRegistry {
+public:
+    using PackageBuilder = std::function<filamat::Package()>;
+
+    explicit MaterialRegistry(filament::Engine& engine);
+
+    // Destroys all the instances handed out by this registry, then all of its materials.
+    ~MaterialRegistry();
+
+    MaterialRegistry(MaterialRegistry const&) = delete;
+    MaterialRegistry& operator=(MaterialRegistry const&) = delete;
+
+    /**
+     * Returns the compiled package registered under name, running builder only the first time
+     * name is requested in this process. Returns nullptr if builder produced an invalid package.
+     */
+    static filamat::Package const* getPackage(std::string const& name, PackageBuilder builder);
+
+    // Returns the Material built from the given package, building it if needed.
+    filament::Material const* getMaterial(void const* data, size_t size);
+
+    filament::Material const* getMaterial(filamat::Package const& package) {
+        return getMaterial(package.getData(), package.getSize());
+    }
+
+    // Returns the parameter handles of a material, resolved the first time they're requested.
+    MaterialParameters& getParameters(filament::Material const* material);
+
+    // Sums and resets the update counters of every material, typically once per frame.
+    MaterialParameters::Stats resetStats() noexcept;
+
+    // Creates an instance owned by this registry.
+    filament::MaterialInstance* createInstance(filament::Material const* material,
+            const char* name = nullptr);
+
+    // Destroys an instance created by createInstance() before the registry goes away.
+    void destroyInstance(filament::MaterialInstance* mi);
+
+    // Returns a recycled instance of material if one is available, a new one otherwise.
+    filament::MaterialInstance* acquireInstance(filament::Material const* material);
+
+    // Resets mi to its pool's defaults and keeps it for reuse, unless the pool is already
+    // holding as many free instances as its high-water mark, in which case mi is destroyed.
+    // An instance the registry didn't create is adopted: it's owned by the registry from then on.
+    void releaseInstance(filament::MaterialInstance* mi);
+
+    // Values applied to instances of material when they're released, only float parameters
+    // can be reset (see MaterialParameters::apply).
+    void setPoolDefaults(filament::Material const* material,
+            std::vector<MaterialParameters::Update> defaults);
+
+    // Maximum number of free instances kept per material.
+    void setPoolHighWaterMark(size_t count);
+
+    size_t getMaterialCount() const noexcept { return mMaterials.size(); }
+
+private:
+    struct Pool {
+        std::vector<filament::MaterialInstance*> free;
+        std::vector<MaterialParameters::Update> defaults;
+    };
+
+    struct Entry {
+        std::vector<uint8_t> package;
+        filament::Material* material;
+    };
+
+    static uint32_t hashPackage(void const* data, size_t size) noexcept;
+
+    filament::Engine& mEngine;
+    // several packages can share a hash, so each bucket keeps every package it has seen
+    tsl::robin_map<uint32_t, std::vector<Entry>> mCache;
+    std::vector<filament::Material*> mMaterials;
+    // boxed so references handed out stay valid when the map grows
+    tsl::robin_map<filament::Material const*, std::unique_ptr<MaterialParameters>> mParameters;
+    std::vector<filament::MaterialInstance*> mInstances;
+    tsl::robin_map<filament::Material const*, Pool> mPools;
+    size_t mPoolHighWaterMark = 16;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_MATERIALREGISTRY_H
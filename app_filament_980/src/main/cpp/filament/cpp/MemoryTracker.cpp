@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MemoryTracker.h"
+
+#include <filament/Texture.h>
+
+#include <algorithm>
+#include <sstream>
+
+using namespace filament;
+
+MemoryTracker& MemoryTracker::get() noexcept {
+    static auto& sTracker = *new MemoryTracker();
+    return sTracker;
+}
+
+void MemoryTracker::add(Category category, size_t size) noexcept {
+    Usage& usage = mUsage[size_t(category)];
+    usage.live += size;
+    usage.peak = std::max(usage.peak, usage.live);
+    usage.count++;
+    mTotal.live += size;
+    mTotal.peak = std::max(mTotal.peak, mTotal.live);
+    mTotal.count++;
+}
+
+void MemoryTracker::remove(Category category, size_t size) noexcept {
+    Usage& usage = mUsage[size_t(category)];
+    usage.live -= size;
+    usage.count--;
+    mTotal.live -= size;
+    mTotal.count--;
+}
+
+void MemoryTracker::track(Category category, void const* key, size_t size) noexcept {
+    if (!key) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mLock);
+    auto iter = mEntries.find(key);
+    if (iter != mEntries.end()) {
+        remove(iter->second.category, iter->second.size);
+        iter.value() = { category, size };
+    } else {
+        mEntries.emplace(key, Entry{ category, size });
+    }
+    add(category, size);
+}
+
+void MemoryTracker::untrack(void const* key) noexcept {
+    std::lock_guard<std::mutex> lock(mLock);
+    auto iter = mEntries.find(key);
+    if (iter != mEntries.end()) {
+        remove(iter->second.category, iter->second.size);
+        mEntries.erase(iter);
+    }
+}
+
+MemoryTracker::Usage MemoryTracker::getUsage(Category category) const noexcept {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mUsage[size_t(category)];
+}
+
+MemoryTracker::Usage MemoryTracker::getTotal() const noexcept {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mTotal;
+}
+
+const char* MemoryTracker::getName(Category category) noexcept {
+    switch (category) {
+        case Category::GEOMETRY: return "geometry";
+        case Category::TEXTURES: return "textures";
+        case Category::ENVIRONMENT: return "environment";
+        case Category::MATERIALS: return "materials";
+        case Category::STAGING: return "staging";
+        case Category::ASSETS: return "assets";
+    }
+    return "unknown";
+}
+
+std::string MemoryTracker::toJson() const {
+    auto write = [](std::ostringstream& out, Usage const& usage) {
+        out << "{\"live\":" << usage.live << ",\"peak\":" << usage.peak
+            << ",\"count\":" << usage.count << "}";
+    };
+
+    std::lock_guard<std::mutex> lock(mLock);
+    std::ostringstream out;
+    out << "{";
+    for (size_t i = 0; i < CATEGORY_COUNT; i++) {
+        out << "\"" << getName(Category(i)) << "\":";
+        write(out, mUsage[i]);
+        out << ",";
+    }
+    out << "\"total\":";
+    write(out, mTotal);
+    out << "}";
+    return out.str();
+}
+
+// Bits per texel, as allocated by the GPU: 3-component formats are usually padded.
+static size_t getBitsPerTexel(Texture::InternalFormat format) noexcept {
+    using Format = Texture::InternalFormat;
+    switch (format) {
+        case Format::R8:
+        case Format::R8_SNORM:
+        case Format::R8UI:
+        case Format::R8I:
+        case Format::STENCIL8:
+            return 8;
+        case Format::R16F:
+        case Format::R16UI:
+        case Format::R16I:
+        case Format::RG8:
+        case Format::RG8_SNORM:
+        case Format::RG8UI:
+        case Format::RG8I:
+        case Format::RGB565:
+        case Format::RGB5_A1:
+        case Format::RGBA4:
+        case Format::DEPTH16:
+            return 16;
+        case Format::RGBA16F:
+        case Format::RGBA16UI:
+        case Format::RGBA16I:
+        case Format::RGB16F:
+        case Format::RGB16UI:
+        case Format::RGB16I:
+            return 64;
+        case Format::RG16F:
+        case Format::RG16UI:
+        case Format::RG16I:
+        case Format::R32F:
+        case Format::R32UI:
+        case Format::R32I:
+            return 32;
+        case Format::RG32F:
+        case Format::RG32UI:
+        case Format::RG32I:
+            return 64;
+        case Format::RGB32F:
+        case Format::RGB32UI:
+        case Format::RGB32I:
+        case Format::RGBA32F:
+        case Format::RGBA32UI:
+        case Format::RGBA32I:
+            return 128;
+        case Format::EAC_R11:
+        case Format::EAC_R11_SIGNED:
+        case Format::ETC2_RGB8:
+        case Format::ETC2_SRGB8:
+        case Format::ETC2_RGB8_A1:
+        case Format::ETC2_SRGB8_A1:
+        case Format::DXT1_RGB:
+        case Format::DXT1_RGBA:
+        case Format::DXT1_SRGB:
+        case Format::DXT1_SRGBA:
+            return 4;
+        case Format::EAC_RG11:
+        case Format::EAC_RG11_SIGNED:
+        case Format::ETC2_EAC_RGBA8:
+        case Format::ETC2_EAC_SRGBA8:
+        case Format::DXT3_RGBA:
+        case Format::DXT3_SRGBA:
+        case Format::DXT5_RGBA:
+        case Format::DXT5_SRGBA:
+            return 8;
+        default:
+            // the remaining 32 bits formats, ASTC is sized by block in getTextureSize()
+            return 32;
+    }
+}
+
+// Texels covered by the 128 bits blocks of an ASTC format, false for other formats.
+static bool getAstcBlockSize(Texture::InternalFormat format,
+        size_t* width, size_t* height) noexcept {
+    using Format = Texture::InternalFormat;
+    // both ranges are declared in the same order, from 4x4 to 12x12
+    static constexpr uint8_t BLOCK_SIZES[][2] = {
+            { 4, 4 }, { 5, 4 }, { 5, 5 }, { 6, 5 }, { 6, 6 }, { 8, 5 }, { 8, 6 },
+            { 8, 8 }, { 10, 5 }, { 10, 6 }, { 10, 8 }, { 10, 10 }, { 12, 10 }, { 12, 12 }
+    };
+    size_t index;
+    if (format >= Format::RGBA_ASTC_4x4 && format <= Format::RGBA_ASTC_12x12) {
+        index = size_t(format) - size_t(Format::RGBA_ASTC_4x4);
+    } else if (format >= Format::SRGB8_ALPHA8_ASTC_4x4 &&
+            format <= Format::SRGB8_ALPHA8_ASTC_12x12) {
+        index = size_t(format) - size_t(Format::SRGB8_ALPHA8_ASTC_4x4);
+    } else {
+        return false;
+    }
+    *width = BLOCK_SIZES[index][0];
+    *height = BLOCK_SIZES[index][1];
+    return true;
+}
+
+size_t MemoryTracker::getTextureSize(Texture const* texture) noexcept {
+    if (!texture) {
+        return 0;
+    }
+    size_t size = 0;
+    size_t blockWidth, blockHeight;
+    if (getAstcBlockSize(texture->getFormat(), &blockWidth, &blockHeight)) {
+        // 128/(w*h) bits per texel, from 8 down to less than 1: counted in whole blocks
+        for (size_t level = 0; level < texture->getLevels(); level++) {
+            size_t const blocks = (texture->getWidth(level) + blockWidth - 1) / blockWidth *
+                    ((texture->getHeight(level) + blockHeight - 1) / blockHeight);
+            size += blocks * texture->getDepth(level) * 16;
+        }
+    } else {
+        for (size_t level = 0; level < texture->getLevels(); level++) {
+            size += texture->getWidth(level) * texture->getHeight(level) *
+                    texture->getDepth(level);
+        }
+        size = size * getBitsPerTexel(texture->getFormat()) / 8;
+    }
+    if (texture->getTarget() == Texture::Sampler::SAMPLER_CUBEMAP) {
+        size *= 6;
+    }
+    return size;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_MEMORYTRACKER_H
+#define TNT_FILAMENT_SAMPLE_MEMORYTRACKER_H
+
+#include <tsl/robin_map.h>
+
+#include <mutex>
+#include <string>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+class Texture;
+}
+
+/**
+ * Accounts for the memory held by the sample's subsystems, so that scenes can be kept within a
+ * budget on low-RAM devices.
+ *
+ * Every allocation is tracked under a key, typically the object owning it (a VertexBuffer, a
+ * Texture, a pool slab...), and tagged with a category. The sizes of GPU resources are estimated
+ * from their description, as the driver doesn't report them.
+ *
+ * The tracker is process-wide and thread-safe.
+ */
+class MemoryTracker {
+public:
+    enum class Category : uint8_t {
+        GEOMETRY,       // GPU: vertex and index buffers
+        TEXTURES,       // GPU: material and camera textures
+        ENVIRONMENT,    // GPU: IBL and skybox cubemaps
+        MATERIALS,      // CPU: material packages
+        STAGING,        // CPU: upload buffers and scratch memory
+        ASSETS,         // CPU: glTF assets, by the size of their source data
+    };
+    static constexpr size_t CATEGORY_COUNT = 6;
+
+    struct Usage {
+        size_t live = 0;
+        size_t peak = 0;
+        uint32_t count = 0;     // live allocations
+    };
+
+    // Intentionally leaked, allocations may be released by the engine's thread at any time.
+    static MemoryTracker& get() noexcept;
+
+    // Tracks size bytes under key, replacing what key was tracking if anything.
+    void track(Category category, void const* key, size_t size) noexcept;
+
+    // Forgets about key, if it's tracked.
+    void untrack(void const* key) noexcept;
+
+    Usage getUsage(Category category) const noexcept;
+    Usage getTotal() const noexcept;
+
+    // Usage of each category and the total, as a JSON object.
+    std::string toJson() const;
+
+    static const char* getName(Category category) noexcept;
+
+    // Estimated size of a texture in GPU memory, with its mip levels and faces.
+    static size_t getTextureSize(filament::Texture const* texture) noexcept;
+
+private:
+    struct Entry {
+        Category category;
+        size_t size;
+    };
+
+    MemoryTracker() noexcept = default;
+
+    void add(Category category, size_t size) noexcept;
+    void remove(Category category, size_t size) noexcept;
+
+    mutable std::mutex mLock;
+    tsl::robin_map<void const*, Entry> mEntries;    // guarded by mLock
+    Usage mUsage[CATEGORY_COUNT];                   // guarded by mLock
+    Usage mTotal;                                   // guarded by mLock
+};
+
+#endif // TNT_FILAMENT_SAMPLE_MEMORYTRACKER_H
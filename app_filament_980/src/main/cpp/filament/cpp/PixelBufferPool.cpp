@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PixelBufferPool.h"
+
+#include "MemoryTracker.h"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace utils;
+
+PixelBufferPool& PixelBufferPool::get() noexcept {
+    static auto& sPool = *new PixelBufferPool();
+    return sPool;
+}
+
+size_t PixelBufferPool::getClass(size_t size) noexcept {
+    // four classes per power of two: (5, 6, 7 or 8) << (log2 - 2), the first three are unused
+    size_t const s = std::max(size, size_t(1) << (MIN_LOG2 + 1)) - 1;
+    unsigned const log2 = 63u - unsigned(__builtin_clzll(uint64_t(s)));
+    size_t const sub = (s >> (log2 - 2u)) & 3u;
+    return (log2 - MIN_LOG2) * 4u + sub;
+}
+
+size_t PixelBufferPool::getClassSize(size_t index) noexcept {
+    return size_t(5 + index % 4) << (MIN_LOG2 + index / 4 - 2);
+}
+
+void* PixelBufferPool::alloc(size_t size) noexcept {
+    size_t const index = getClass(size);
+    if (index >= CLASS_COUNT) {
+        void* const p = ::malloc(size);
+        MemoryTracker::get().track(MemoryTracker::Category::STAGING, p, size);
+        std::lock_guard<std::mutex> lock(mLock);
+        mStats.heapAllocations++;
+        return p;
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+    std::vector<Slab>& slabs = mClasses[index];
+    auto slab = std::find_if(slabs.begin(), slabs.end(),
+            [](Slab const& slab) { return slab.used < slab.count; });
+    size_t const classSize = getClassSize(index);
+    if (slab == slabs.end()) {
+        uint32_t const count = uint32_t(std::max(SLAB_SIZE / classSize, size_t(1)));
+        // room for aligning the first buffer
+        size_t const areaSize = count * classSize + ALIGNMENT;
+        std::unique_ptr<HeapArea> area(new HeapArea(areaSize));
+        if (!area->data()) {
+            return nullptr;
+        }
+        FreeList free(area->begin(), area->end(), classSize, ALIGNMENT, 0);
+        MemoryTracker::get().track(MemoryTracker::Category::STAGING, area.get(), areaSize);
+        slabs.push_back({ std::move(area), std::move(free), count, 0 });
+        slab = slabs.end() - 1;
+        mStats.reserved += areaSize;
+        mStats.slabs++;
+        mStats.heapAllocations++;
+    }
+    slab->used++;
+    mStats.used += classSize;
+    return slab->free.pop();
+}
+
+void PixelBufferPool::free(void* p, size_t size) noexcept {
+    if (!p) {
+        return;
+    }
+    size_t const index = getClass(size);
+    if (index >= CLASS_COUNT) {
+        MemoryTracker::get().untrack(p);
+        ::free(p);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+    std::vector<Slab>& slabs = mClasses[index];
+    auto slab = std::find_if(slabs.begin(), slabs.end(), [p](Slab const& slab) {
+        return p >= slab.area->begin() && p < slab.area->end();
+    });
+    assert(slab != slabs.end());
+    if (slab != slabs.end()) {
+        slab->free.push(p);
+        slab->used--;
+        mStats.used -= getClassSize(index);
+    }
+}
+
+void PixelBufferPool::release(void* buffer, size_t size, void* user) noexcept {
+    static_cast<PixelBufferPool*>(user)->free(buffer, size);
+}
+
+void* PixelBufferPool::allocTagged(size_t size) noexcept {
+    uint8_t* const p = static_cast<uint8_t*>(alloc(size + TAG_SIZE));
+    if (!p) {
+        return nullptr;
+    }
+    memcpy(p, &size, sizeof(size));
+    return p + TAG_SIZE;
+}
+
+void* PixelBufferPool::reallocTagged(void* p, size_t size) noexcept {
+    if (!p) {
+        return allocTagged(size);
+    }
+    size_t previous;
+    memcpy(&previous, static_cast<uint8_t*>(p) - TAG_SIZE, sizeof(previous));
+    if (getClass(size + TAG_SIZE) == getClass(previous + TAG_SIZE) &&
+            getClass(size + TAG_SIZE) < CLASS_COUNT) {
+        // still fits in its buffer
+        memcpy(static_cast<uint8_t*>(p) - TAG_SIZE, &size, sizeof(size));
+        return p;
+    }
+    void* const q = allocTagged(size);
+    if (q) {
+        memcpy(q, p, std::min(size, previous));
+        freeTagged(p);
+    }
+    return q;
+}
+
+void PixelBufferPool::freeTagged(void* p) noexcept {
+    if (p) {
+        uint8_t* const base = static_cast<uint8_t*>(p) - TAG_SIZE;
+        size_t size;
+        memcpy(&size, base, sizeof(size));
+        free(base, size + TAG_SIZE);
+    }
+}
+
+void PixelBufferPool::trim() noexcept {
+    std::lock_guard<std::mutex> lock(mLock);
+    for (std::vector<Slab>& slabs : mClasses) {
+        auto last = std::remove_if(slabs.begin(), slabs.end(), [this](Slab const& slab) {
+            if (slab.used) {
+                return false;
+            }
+            MemoryTracker::get().untrack(slab.area.get());
+            mStats.reserved -= slab.area->getSize();
+            mStats.slabs--;
+            return true;
+        });
+        slabs.erase(last, slabs.end());
+    }
+}
+
+PixelBufferPool::Stats PixelBufferPool::getStats() const noexcept {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mStats;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_PIXELBUFFERPOOL_H
+#define TNT_FILAMENT_SAMPLE_PIXELBUFFERPOOL_H
+
+#include <utils/Allocator.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Recycles the memory of texture uploads. Buffers are rounded up to a size class, four per
+ * power of two from 4 KiB to 64 MiB, and carved out of slabs that are kept until trim(): when
+ * the engine calls release() on a buffer it's done with, the buffer goes back to the free list
+ * of its class, ready for the next upload of a similar size. Streaming textures of stable sizes
+ * doesn't allocate once the slabs are warm.
+ *
+ * Larger buffers come from the heap. The pool is process-wide and thread-safe, as the engine
+ * releases buffers from its own thread.
+ */
+class PixelBufferPool {
+public:
+    struct Stats {
+        size_t reserved = 0;        // bytes held in slabs
+        size_t used = 0;            // bytes of the slabs handed out
+        uint32_t slabs = 0;
+        uint32_t heapAllocations = 0;   // slabs and large buffers allocated so far
+    };
+
+    // Intentionally leaked, buffers may be released by the engine at any time.
+    static PixelBufferPool& get() noexcept;
+
+    // Returns a buffer of at least size bytes, 64 bytes aligned for sizes within the classes.
+    void* alloc(size_t size) noexcept;
+
+    // Gives back a buffer returned by alloc(size).
+    void free(void* p, size_t size) noexcept;
+
+    // A PixelBufferDescriptor callback, for buffers from alloc(). user must be the pool.
+    static void release(void* buffer, size_t size, void* user) noexcept;
+
+    /**
+     * Same as alloc()/free() for clients that don't keep the size of their allocations, which is
+     * stored in front of the buffer instead (e.g. stb_image).
+     */
+    void* allocTagged(size_t size) noexcept;
+    void* reallocTagged(void* p, size_t size) noexcept;
+    void freeTagged(void* p) noexcept;
+
+    // Frees the slabs that have no buffer in use, e.g. once a load is complete.
+    void trim() noexcept;
+
+    Stats getStats() const noexcept;
+
+private:
+    static constexpr size_t ALIGNMENT = 64;
+    static constexpr size_t TAG_SIZE = 16;
+    static constexpr unsigned MIN_LOG2 = 11;
+    static constexpr size_t CLASS_COUNT = 60;   // up to 64 MiB
+    static constexpr size_t SLAB_SIZE = 1024 * 1024;
+
+    struct Slab {
+        std::unique_ptr<utils::HeapArea> area;
+        utils::FreeList free;
+        uint32_t count = 0;
+        uint32_t used = 0;
+    };
+
+    static size_t getClass(size_t size) noexcept;
+    static size_t getClassSize(size_t index) noexcept;
+
+    PixelBufferPool() noexcept = default;
+
+    mutable std::mutex mLock;
+    std::vector<Slab> mClasses[CLASS_COUNT];    // guarded by mLock
+    Stats mStats;                               // guarded by mLock
+};
+
+#endif // TNT_FILAMENT_SAMPLE_PIXELBUFFERPOOL_H
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_REDRAWTRACKER_H
+#define TNT_FILAMENT_SAMPLE_REDRAWTRACKER_H
+
+#include <stdint.h>
+
+/**
+ * Tells whether the next frame needs to be drawn at all. Everything that changes what's on
+ * screen (transforms, materials, cameras, viewports, loaded content) invalidates the tracker,
+ * which then asks for a few more frames to let temporal effects converge. Rendering on demand is
+ * off by default, in which case every frame is drawn.
+ *
+ * Sources that change on their own, like an external camera stream, make rendering continuous
+ * for as long as they're active.
+ */
+class RedrawTracker {
+public:
+    enum Reason : uint32_t {
+        TRANSFORM   = 0x01,
+        MATERIAL    = 0x02,
+        CAMERA      = 0x04,
+        VIEWPORT    = 0x08,
+        CONTENT     = 0x10,
+        REQUESTED   = 0x20,
+    };
+
+    struct Stats {
+        uint32_t rendered = 0;
+        uint32_t skipped = 0;
+    };
+
+    void setOnDemand(bool enabled) noexcept {
+        mOnDemand = enabled;
+        invalidate(REQUESTED);
+    }
+
+    bool isOnDemand() const noexcept { return mOnDemand; }
+
+    void setContinuous(bool continuous) noexcept { mContinuous = continuous; }
+
+    void invalidate(uint32_t reasons) noexcept {
+        mReasons |= reasons;
+        mFramesLeft = SETTLE_FRAME_COUNT;
+    }
+
+    bool shouldRender() const noexcept {
+        return !mOnDemand || mContinuous || mFramesLeft > 0;
+    }
+
+    // What invalidated the tracker since the last rendered frame.
+    uint32_t getReasons() const noexcept { return mReasons; }
+
+    // Only counts frames actually drawn, a frame dropped by Renderer::beginFrame() isn't one.
+    void frameRendered() noexcept {
+        if (mFramesLeft > 0) {
+            mFramesLeft--;
+        }
+        mReasons = 0;
+        mStats.rendered++;
+    }
+
+    void frameSkipped() noexcept { mStats.skipped++; }
+
+    // Returns the counters accumulated since the last call and resets them.
+    Stats resetStats() noexcept {
+        Stats const stats = mStats;
+        mStats = {};
+        return stats;
+    }
+
+private:
+    // frames drawn after the last change, for TAA and dynamic resolution to settle
+    static constexpr uint32_t SETTLE_FRAME_COUNT = 2;
+
+    bool mOnDemand = false;
+    bool mContinuous = false;
+    uint32_t mReasons = CONTENT;
+    uint32_t mFramesLeft = SETTLE_FRAME_COUNT;
+    Stats mStats;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_REDRAWTRACKER_H
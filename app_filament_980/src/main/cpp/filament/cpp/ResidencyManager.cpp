@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ResidencyManager.h"
+
+void ResidencyManager::add(void const* key, size_t bytes) {
+    auto result = mEntries.emplace(key, Entry{ bytes, mFrame });
+    if (!result.second) {
+        mResident -= result.first->second.bytes;
+        result.first.value() = { bytes, mFrame };
+    }
+    mResident += bytes;
+}
+
+void ResidencyManager::remove(void const* key) noexcept {
+    auto iter = mEntries.find(key);
+    if (iter != mEntries.end()) {
+        mResident -= iter->second.bytes;
+        mEntries.erase(iter);
+    }
+}
+
+void ResidencyManager::touch(void const* key, size_t bytes) noexcept {
+    auto iter = mEntries.find(key);
+    if (iter != mEntries.end()) {
+        mResident = mResident - iter->second.bytes + bytes;
+        iter.value() = { bytes, mFrame };
+    }
+}
+
+void ResidencyManager::resize(void const* key, size_t bytes) noexcept {
+    auto iter = mEntries.find(key);
+    if (iter != mEntries.end()) {
+        mResident = mResident - iter->second.bytes + bytes;
+        iter.value().bytes = bytes;
+    }
+}
+
+void ResidencyManager::endFrame() {
+    while (mResident > mBudget) {
+        // catalogs hold a handful of groups, a scan per eviction is cheap enough
+        auto victim = mEntries.end();
+        for (auto iter = mEntries.begin(); iter != mEntries.end(); ++iter) {
+            if (iter->second.lastUsed < mFrame &&
+                    (victim == mEntries.end() || iter->second.lastUsed < victim->second.lastUsed)) {
+                victim = iter;
+            }
+        }
+        if (victim == mEntries.end()) {
+            // everything left is in use
+            break;
+        }
+        void const* const key = victim->first;
+        mResident -= victim->second.bytes;
+        mEntries.erase(victim);
+        mEvictions++;
+        mEvictor(key);
+    }
+    mFrame++;
+}
+
+ResidencyManager::Stats ResidencyManager::getStats() const noexcept {
+    Stats stats;
+    stats.budget = mBudget;
+    stats.resident = mResident;
+    stats.count = uint32_t(mEntries.size());
+    stats.evictions = mEvictions;
+    return stats;
+}
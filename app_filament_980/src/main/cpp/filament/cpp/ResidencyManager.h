@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_RESIDENCYMANAGER_H
+#define TNT_FILAMENT_SAMPLE_RESIDENCYMANAGER_H
+
+#include <tsl/robin_map.h>
+
+#include <functional>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Keeps the GPU resources of the scene within a memory budget. Resources are registered as
+ * groups (e.g. a mesh with its buffers and textures) along with their estimated size, and are
+ * touched on every frame they're in use. At the end of a frame, groups are evicted starting with
+ * the least recently used one until the total fits the budget again; groups used during that
+ * frame are never evicted, so the budget can be exceeded by what's on screen.
+ */
+class ResidencyManager {
+public:
+    // Destroys the group registered as key, which is already forgotten by the manager.
+    using Evictor = std::function<void(void const* key)>;
+
+    struct Stats {
+        size_t budget = 0;
+        size_t resident = 0;    // bytes
+        uint32_t count = 0;     // resident groups
+        uint32_t evictions = 0; // so far
+    };
+
+    ResidencyManager(size_t budget, Evictor evictor) noexcept
+            : mEvictor(std::move(evictor)), mBudget(budget) { }
+
+    ResidencyManager(ResidencyManager const&) = delete;
+    ResidencyManager& operator=(ResidencyManager const&) = delete;
+
+    void setBudget(size_t bytes) noexcept { mBudget = bytes; }
+
+    // Registers a group, as used during the current frame.
+    void add(void const* key, size_t bytes);
+
+    // Forgets about a group its owner destroyed.
+    void remove(void const* key) noexcept;
+
+    // Marks a group as used during the current frame, with its current size.
+    void touch(void const* key, size_t bytes) noexcept;
+
+    // Updates the size of a group whose resources changed, without marking it as used.
+    void resize(void const* key, size_t bytes) noexcept;
+
+    // Evicts groups unused this frame while over budget, then moves on to the next frame.
+    void endFrame();
+
+    Stats getStats() const noexcept;
+
+private:
+    struct Entry {
+        size_t bytes;
+        uint64_t lastUsed;
+    };
+
+    Evictor mEvictor;
+    tsl::robin_map<void const*, Entry> mEntries;
+    size_t mBudget;
+    size_t mResident = 0;
+    uint64_t mFrame = 0;
+    uint32_t mEvictions = 0;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_RESIDENCYMANAGER_H
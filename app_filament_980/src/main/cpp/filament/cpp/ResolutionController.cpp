@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ResolutionController.h"
+
+#include <filament/Engine.h>
+#include <filament/Fence.h>
+#include <filament/View.h>
+
+#include <math/scalar.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace filament;
+using namespace filament::math;
+
+// weight of the last frame in the smoothed frame time
+static constexpr float FRAME_TIME_SMOOTHING = 0.2f;
+
+ResolutionController::~ResolutionController() {
+    if (mFence) {
+        mEngine.destroy(mFence);
+    }
+}
+
+void ResolutionController::setOptions(Options const& options) noexcept {
+    mOptions = options;
+    mOptions.minScale = clamp(options.minScale, 0.1f, 1.0f);
+    mOptions.maxScale = clamp(options.maxScale, mOptions.minScale, 1.0f);
+    mArea = mOptions.maxScale * mOptions.maxScale;
+    mPreviousError = 0.0f;
+    mPreviousError2 = 0.0f;
+    mSmoothedFrameTimeMs = 0.0f;
+    mState = {};
+    mState.scale = mOptions.enabled ? mOptions.maxScale : 1.0f;
+}
+
+void ResolutionController::beginFrame() noexcept {
+    mFrameStart = clock::now();
+    pollFence();
+}
+
+void ResolutionController::pollFence() noexcept {
+    if (!mFence) {
+        return;
+    }
+    Fence::FenceStatus const status = mFence->wait(Fence::Mode::FLUSH, 0);
+    std::chrono::duration<float, std::milli> const elapsed = clock::now() - mFenceStart;
+    if (status == Fence::FenceStatus::TIMEOUT_EXPIRED) {
+        // still running, the GPU is behind: its frame time is at least this long
+        mFenceLate = true;
+        mState.gpuFrameTimeMs = elapsed.count();
+        return;
+    }
+    if (status == Fence::FenceStatus::CONDITION_SATISFIED && mFenceLate) {
+        mState.gpuFrameTimeMs = elapsed.count();
+    } else {
+        // signalled within a frame, the GPU isn't what limits the frame rate
+        mState.gpuFrameTimeMs = 0.0f;
+    }
+    mEngine.destroy(mFence);
+    mFence = nullptr;
+}
+
+void ResolutionController::endFrame(bool rendered) noexcept {
+    std::chrono::duration<float, std::milli> const cpu = clock::now() - mFrameStart;
+    mState.cpuFrameTimeMs = cpu.count();
+    if (!rendered || !mOptions.enabled) {
+        return;
+    }
+    if (!mFence) {
+        mFence = mEngine.createFence();
+        mFenceStart = clock::now();
+        mFenceLate = false;
+    }
+    update(std::max(mState.cpuFrameTimeMs, mState.gpuFrameTimeMs));
+}
+
+void ResolutionController::update(float frameTimeMs) noexcept {
+    mSmoothedFrameTimeMs = mSmoothedFrameTimeMs > 0.0f
+            ? mix(mSmoothedFrameTimeMs, frameTimeMs, FRAME_TIME_SMOOTHING)
+            : frameTimeMs;
+
+    float const target = mOptions.targetFrameTimeMs;
+    mState.errorMs = mSmoothedFrameTimeMs - target;
+
+    // normalized, positive when there's headroom to render more pixels
+    float const error = -mState.errorMs / target;
+
+    // velocity form: the area accumulates the output, clamping it is enough to avoid windup
+    float const delta = mOptions.kp * (error - mPreviousError)
+            + mOptions.ki * error
+            + mOptions.kd * (error - 2.0f * mPreviousError + mPreviousError2);
+    mPreviousError2 = mPreviousError;
+    mPreviousError = error;
+
+    float const minArea = mOptions.minScale * mOptions.minScale;
+    float const maxArea = mOptions.maxScale * mOptions.maxScale;
+    mArea = clamp(mArea + delta, minArea, maxArea);
+    mState.scale = std::sqrt(mArea);
+}
+
+void ResolutionController::apply(View& view) const noexcept {
+    View::DynamicResolutionOptions options = view.getDynamicResolutionOptions();
+    options.enabled = mOptions.enabled && mState.scale < 1.0f;
+    options.minScale = float2(mState.scale);
+    options.maxScale = float2(mState.scale);
+    options.homogeneousScaling = true;
+    view.setDynamicResolutionOptions(options);
+}
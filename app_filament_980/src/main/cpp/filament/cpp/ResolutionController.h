@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_RESOLUTIONCONTROLLER_H
+#define TNT_FILAMENT_SAMPLE_RESOLUTIONCONTROLLER_H
+
+#include <chrono>
+
+namespace filament {
+class Engine;
+class Fence;
+class View;
+}
+
+/**
+ * Scales the resolution of the views so that frames fit in a target frame time.
+ *
+ * The frame time is the larger of the CPU time spent between beginFrame() and endFrame() and,
+ * when the GPU falls behind, the time it takes for a fence created at the end of a frame to
+ * signal. The fence is only polled once per frame, so the GPU time is only known when it
+ * exceeds the frame interval, which is exactly when it matters.
+ *
+ * A PID controller, in velocity form, works on the rendered area (the square of the scale), which the cost of a
+ * frame is roughly proportional to. The scale is then pinned on every view through its
+ * DynamicResolutionOptions, with equal min and max scales so that the engine doesn't apply a
+ * heuristic of its own.
+ */
+class ResolutionController {
+public:
+    struct Options {
+        bool enabled = false;
+        float targetFrameTimeMs = 1000.0f / 60.0f;
+        float minScale = 0.5f;
+        float maxScale = 1.0f;
+        float kp = 0.1f;
+        float ki = 0.05f;
+        float kd = 0.02f;
+    };
+
+    struct State {
+        float scale = 1.0f;
+        float cpuFrameTimeMs = 0.0f;
+        float gpuFrameTimeMs = 0.0f;    // 0 while the GPU keeps up with the frame rate
+        float errorMs = 0.0f;           // positive when frames take longer than the target
+    };
+
+    explicit ResolutionController(filament::Engine& engine) noexcept : mEngine(engine) { }
+    ~ResolutionController();
+
+    ResolutionController(ResolutionController const&) = delete;
+    ResolutionController& operator=(ResolutionController const&) = delete;
+
+    // Resets the controller, the scale restarts from the maximum.
+    void setOptions(Options const& options) noexcept;
+    Options const& getOptions() const noexcept { return mOptions; }
+
+    State const& getState() const noexcept { return mState; }
+
+    void beginFrame() noexcept;
+
+    // Must be called after Renderer::endFrame(), or instead of it when the frame was skipped.
+    void endFrame(bool rendered) noexcept;
+
+    // Applies the current scale, call for every view after endFrame().
+    void apply(filament::View& view) const noexcept;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    void pollFence() noexcept;
+    void update(float frameTimeMs) noexcept;
+
+    filament::Engine& mEngine;
+    Options mOptions;
+    State mState;
+    clock::time_point mFrameStart;
+    filament::Fence* mFence = nullptr;
+    clock::time_point mFenceStart;
+    bool mFenceLate = false;
+    float mSmoothedFrameTimeMs = 0.0f;
+    float mArea = 1.0f;
+    float mPreviousError = 0.0f;
+    float mPreviousError2 = 0.0f;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_RESOLUTIONCONTROLLER_H
@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TextureDownscaler.h"
+
+#include "PixelBufferPool.h"
+
+#include <image/ColorTransform.h>
+#include <image/LinearImage.h>
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace image;
+
+namespace {
+
+// Alpha is always linear, the color channels are when sRGB is false.
+LinearImage toLinearImage(uint8_t const* src, uint32_t w, uint32_t h, uint32_t channels,
+        bool sRGB) {
+    LinearImage result(w, h, channels);
+    float* d = result.getPixelRef();
+    size_t const count = size_t(w) * h;
+    if (!sRGB) {
+        for (size_t i = 0; i < count * channels; i++) {
+            d[i] = src[i] * (1.0f / 255.0f);
+        }
+        return result;
+    }
+    // the whole image goes through the table, then alpha is fixed up
+    sRGBToLinear(src, d, count * channels);
+    for (uint32_t c = 3; c < channels; c++) {
+        for (size_t i = c; i < count * channels; i += channels) {
+            d[i] = src[i] * (1.0f / 255.0f);
+        }
+    }
+    return result;
+}
+
+void fromLinearImage(LinearImage const& image, uint8_t* dst, bool sRGB) {
+    uint32_t const channels = image.getChannels();
+    float const* p = image.getPixelRef();
+    size_t const count = size_t(image.getWidth()) * image.getHeight() * channels;
+    if (!sRGB) {
+        for (size_t i = 0; i < count; i++) {
+            dst[i] = uint8_t(filament::math::saturate(p[i]) * 255.0f + 0.5f);
+        }
+        return;
+    }
+    linearTosRGB(p, dst, count);
+    for (uint32_t c = 3; c < channels; c++) {
+        for (size_t i = c; i < count; i += channels) {
+            dst[i] = uint8_t(filament::math::saturate(p[i]) * 255.0f + 0.5f);
+        }
+    }
+}
+
+} // anonymous namespace
+
+TextureDownscaler::~TextureDownscaler() {
+    std::unique_lock<std::mutex> lock(mLock);
+    mExit = true;
+    mCondition.notify_all();
+    lock.unlock();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+void TextureDownscaler::decode(Image* images, size_t count) {
+    plan(images, count);
+    decodeImages(images, count, nullptr);
+}
+
+std::shared_ptr<TextureDownscaler::Batch> TextureDownscaler::decodeAsync(
+        std::vector<Image> images, Finish finish) {
+    auto batch = std::make_shared<Batch>();
+    batch->images = std::move(images);
+    batch->mFinish = std::move(finish);
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!mThread.joinable()) {
+        mThread = std::thread(&TextureDownscaler::run, this);
+    }
+    mQueue.push_back(batch);
+    mCondition.notify_all();
+    return batch;
+}
+
+void TextureDownscaler::wait(Batch const& batch) {
+    std::unique_lock<std::mutex> lock(mLock);
+    mCondition.wait(lock, [&batch]() { return batch.isDone(); });
+}
+
+TextureDownscaler::Stats TextureDownscaler::getStats() const noexcept {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mStats;
+}
+
+void TextureDownscaler::run() {
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mCondition.wait(lock, [this]() { return mExit || !mQueue.empty(); });
+        if (mExit) {
+            break;
+        }
+        std::shared_ptr<Batch> const batch = std::move(mQueue.front());
+        mQueue.pop_front();
+        lock.unlock();
+        plan(batch->images.data(), batch->images.size());
+        decodeImages(batch->images.data(), batch->images.size(), &batch->mFinish);
+        lock.lock();
+        batch->mDone.store(true, std::memory_order_release);
+        mCondition.notify_all();
+    }
+    // the batches still queued are done without their images
+    for (std::shared_ptr<Batch> const& batch : mQueue) {
+        batch->mDone.store(true, std::memory_order_release);
+    }
+    mQueue.clear();
+    mCondition.notify_all();
+}
+
+void TextureDownscaler::plan(Image* images, size_t count) {
+    // plan the downscaling from the headers
+    std::vector<size_t> bytes(count, 0);
+    size_t total = 0;
+    size_t decodedBytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        Image& image = images[i];
+        image.pixels = nullptr;
+        image.scale = 0;
+        int w, h;
+        if (!stbi_info_from_memory((stbi_uc const*) image.data, (int) image.size, &w, &h,
+                nullptr)) {
+            image.width = image.height = 0;
+            continue;
+        }
+        image.width = uint32_t(w);
+        image.height = uint32_t(h);
+        bytes[i] = size_t(w) * h * image.channels;
+        total += bytes[i];
+        decodedBytes += bytes[i];
+    }
+
+    size_t const budget = mBudget.load(std::memory_order_relaxed);
+    while (total > budget) {
+        size_t victim = count;
+        size_t victimCost = 0;
+        for (size_t i = 0; i < count; i++) {
+            Image const& image = images[i];
+            if (std::min(image.width, image.height) >> (image.scale + 1) < MIN_SIZE) {
+                continue;
+            }
+            size_t const cost = bytes[i] / size_t(image.importance);
+            if (cost > victimCost) {
+                victim = i;
+                victimCost = cost;
+            }
+        }
+        if (victim == count) {
+            // everything is as small as it gets
+            break;
+        }
+        Image& image = images[victim];
+        image.scale++;
+        size_t const halved = size_t(image.width >> image.scale) * (image.height >> image.scale) *
+                image.channels;
+        total -= bytes[victim] - halved;
+        bytes[victim] = halved;
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+    mStats.images += uint32_t(count);
+    mStats.decodedBytes += decodedBytes;
+    mStats.keptBytes += total;
+    for (size_t i = 0; i < count; i++) {
+        mStats.downscaled += images[i].scale ? 1 : 0;
+    }
+}
+
+void TextureDownscaler::decodeImages(Image* images, size_t count, Finish const* finish) const {
+    // each worker takes the next image until there are none left
+    std::atomic<size_t> next{ 0 };
+    auto work = [this, images, count, finish, &next]() {
+        for (size_t i = next++; i < count; i = next++) {
+            process(images[i]);
+            if (finish && *finish) {
+                (*finish)(images[i], i);
+            }
+        }
+    };
+    size_t const threadCount = std::min<size_t>(count,
+            std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threadCount; i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void TextureDownscaler::process(Image& image) const {
+    if (!image.width) {
+        return;
+    }
+    int w, h, n;
+    stbi_uc* decoded = stbi_load_from_memory((stbi_uc const*) image.data, (int) image.size,
+            &w, &h, &n, image.channels);
+    if (!decoded) {
+        return;
+    }
+    if (!image.scale) {
+        image.pixels = decoded;
+        return;
+    }
+
+    LinearImage const source = toLinearImage(decoded, uint32_t(w), uint32_t(h), image.channels,
+            image.sRGB);
+    stbi_image_free(decoded);
+
+    uint32_t const width = std::max(1u, uint32_t(w) >> image.scale);
+    uint32_t const height = std::max(1u, uint32_t(h) >> image.scale);
+    LinearImage const resampled = resampleImage(source, width, height, mFilter.load());
+
+    uint8_t* pixels = (uint8_t*) PixelBufferPool::get().allocTagged(
+            size_t(width) * height * image.channels);
+    if (!pixels) {
+        // out of memory, the image fails like one that cannot be decoded
+        return;
+    }
+    fromLinearImage(resampled, pixels, image.sRGB);
+    image.pixels = pixels;
+    image.width = width;
+    image.height = height;
+}
+
+TextureDownscaler::Image TextureDownscaler::createPreview(Image const& image,
+        uint32_t size) const {
+    Image preview = image;
+    preview.pixels = nullptr;
+    preview.scale = 0;
+    while (std::min(image.width, image.height) >> preview.scale > size) {
+        preview.scale++;
+    }
+    if (!image.pixels || !preview.scale) {
+        return preview;
+    }
+
+    LinearImage const source = toLinearImage((uint8_t const*) image.pixels, image.width,
+            image.height, image.channels, image.sRGB);
+    preview.width = std::max(1u, image.width >> preview.scale);
+    preview.height = std::max(1u, image.height >> preview.scale);
+    LinearImage const resampled = resampleImage(source, preview.width, preview.height,
+            mFilter.load());
+
+    uint8_t* pixels = (uint8_t*) PixelBufferPool::get().allocTagged(
+            size_t(preview.width) * preview.height * preview.channels);
+    if (pixels) {
+        fromLinearImage(resampled, pixels, preview.sRGB);
+        preview.pixels = pixels;
+    }
+    preview.scale += image.scale;
+    return preview;
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_TEXTUREDOWNSCALER_H
+#define TNT_FILAMENT_SAMPLE_TEXTUREDOWNSCALER_H
+
+#include <image/ImageSampler.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Decodes the images of an asset and downscales the ones that don't fit a texture budget before
+ * they're uploaded. The budget applies to each batch given to decode(): images are halved in
+ * turn, the one with the most bytes per unit of importance first, until the batch fits or every
+ * image is down to MIN_SIZE. Their size is known from the headers, so each image is decoded and
+ * resampled only once, on worker threads. decodeAsync() does the same on a loader thread, so that
+ * the caller doesn't wait for the decoding.
+ */
+class TextureDownscaler {
+public:
+    // How much an image matters on screen, e.g. HIGH for an albedo map and LOW for occlusion.
+    enum class Importance : uint8_t {
+        LOW = 1,
+        MEDIUM = 2,
+        HIGH = 4
+    };
+
+    struct Image {
+        // set by the caller
+        void const* data = nullptr;     // encoded
+        size_t size = 0;
+        uint8_t channels = 4;           // of the decoded pixels, whatever the file has
+        bool sRGB = false;              // the color channels are resampled in linear space
+        Importance importance = Importance::HIGH;
+
+        // set by decode(), pixels is null if the image cannot be decoded or there's no memory
+        // for it. They come from the pixel buffer pool and are released with stbi_image_free
+        // (see IBL.cpp).
+        void* pixels = nullptr;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint8_t scale = 0;              // number of times the image was halved
+    };
+
+    struct Stats {
+        uint32_t images = 0;
+        uint32_t downscaled = 0;
+        size_t decodedBytes = 0;    // at full resolution
+        size_t keptBytes = 0;       // after downscaling
+    };
+
+    // Called on a worker thread for each image of a decodeAsync() batch once decoded (pixels are
+    // null if it couldn't be), e.g. to pack or compress it. index is in the batch.
+    using Finish = std::function<void(Image& image, size_t index)>;
+
+    // Images decoded in the background by decodeAsync().
+    class Batch {
+    public:
+        // only accessed by the workers until the batch is done
+        std::vector<Image> images;
+
+        bool isDone() const noexcept { return mDone.load(std::memory_order_acquire); }
+
+    private:
+        friend class TextureDownscaler;
+        Finish mFinish;
+        std::atomic<bool> mDone{ false };
+    };
+
+    static constexpr size_t DEFAULT_BUDGET = 64 * 1024 * 1024;
+    // images are never halved below this size on their shortest side
+    static constexpr uint32_t MIN_SIZE = 64;
+
+    TextureDownscaler() = default;
+
+    // Waits for the batch being decoded, the batches still queued are done without their images.
+    ~TextureDownscaler();
+
+    TextureDownscaler(TextureDownscaler const&) = delete;
+    TextureDownscaler& operator=(TextureDownscaler const&) = delete;
+
+    void setBudget(size_t bytes) noexcept { mBudget = bytes; }
+
+    // The filter used to shrink images, see image::resampleImage().
+    void setFilter(image::Filter filter) noexcept { mFilter = filter; }
+
+    // Decodes count images, and blocks until they're all done.
+    void decode(Image* images, size_t count);
+
+    /**
+     * Queues a batch of images, decoded as by decode() on a loader thread, each followed by
+     * finish. The encoded data of the images must stay valid until the batch is done.
+     */
+    std::shared_ptr<Batch> decodeAsync(std::vector<Image> images, Finish finish);
+
+    // Blocks until a batch returned by decodeAsync() is done.
+    void wait(Batch const& batch);
+
+    /**
+     * Halves a decoded image until its shortest side is at most size, e.g. for a preview that is
+     * uploaded before the image itself. The pixels of the result are null if the image is
+     * already that small, or if there's no memory for them.
+     */
+    Image createPreview(Image const& image, uint32_t size) const;
+
+    // Totals of every decode() and decodeAsync() batch so far.
+    Stats getStats() const noexcept;
+
+private:
+    // Picks the scale of each image.
+    void plan(Image* images, size_t count);
+    void decodeImages(Image* images, size_t count, Finish const* finish) const;
+    void process(Image& image) const;
+    void run();
+
+    // read by the loader thread
+    std::atomic<size_t> mBudget{ DEFAULT_BUDGET };
+    std::atomic<image::Filter> mFilter{ image::Filter::DEFAULT };
+
+    mutable std::mutex mLock;
+    std::condition_variable mCondition;
+    std::deque<std::shared_ptr<Batch>> mQueue;  // guarded by mLock
+    Stats mStats;                               // guarded by mLock
+    bool mExit = false;                         // guarded by mLock
+    std::thread mThread;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_TEXTUREDOWNSCALER_H
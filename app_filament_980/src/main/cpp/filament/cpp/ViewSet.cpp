@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ViewSet.h"
+
+#include <filament/Camera.h>
+#include <filament/Engine.h>
+#include <filament/Renderer.h>
+#include <filament/View.h>
+#include <filament/Viewport.h>
+
+#include <utils/EntityManager.h>
+
+#include <algorithm>
+
+using namespace filament;
+using namespace utils;
+
+ViewSet::ViewSet(Engine& engine, Scene* scene) : mEngine(engine), mScene(scene) {
+    add("Main View", {});
+}
+
+ViewSet::~ViewSet() {
+    while (mViews.size() > 1) {
+        remove(mViews.size() - 1);
+    }
+    Slot const& main = mViews.front();
+    Entity const entity = main.camera->getEntity();
+    mEngine.destroy(main.view);
+    mEngine.destroyCameraComponent(entity);
+    EntityManager::get().destroy(entity);
+}
+
+size_t ViewSet::add(const char* name, Rect rect, bool postProcessing) {
+    Slot slot;
+    slot.view = mEngine.createView();
+    slot.camera = mEngine.createCamera(EntityManager::get().create());
+    slot.rect = rect;
+    slot.view->setName(name);
+    slot.view->setScene(mScene);
+    slot.view->setCamera(slot.camera);
+    slot.view->setPostProcessingEnabled(postProcessing);
+    layout(slot);
+    mViews.push_back(slot);
+    return mViews.size() - 1;
+}
+
+void ViewSet::remove(size_t index) {
+    if (index == 0 || index >= mViews.size()) {
+        return;
+    }
+    Slot const& slot = mViews[index];
+    Entity const entity = slot.camera->getEntity();
+    mEngine.destroy(slot.view);
+    mEngine.destroyCameraComponent(entity);
+    EntityManager::get().destroy(entity);
+    mViews.erase(mViews.begin() + index);
+}
+
+void ViewSet::setRect(size_t index, Rect rect) {
+    mViews[index].rect = rect;
+    layout(mViews[index]);
+}
+
+void ViewSet::setProjection(size_t index, double fovInDegrees, double near, double far) {
+    Slot& slot = mViews[index];
+    slot.fov = fovInDegrees;
+    slot.near = near;
+    slot.far = far;
+    layout(slot);
+}
+
+void ViewSet::resize(uint32_t width, uint32_t height) {
+    mWidth = width;
+    mHeight = height;
+    for (Slot const& slot : mViews) {
+        layout(slot);
+    }
+}
+
+void ViewSet::layout(Slot const& slot) const {
+    if (!mWidth || !mHeight) {
+        return;
+    }
+    Rect const& rect = slot.rect;
+    uint32_t const width = std::max(1u, uint32_t(rect.width * float(mWidth)));
+    uint32_t const height = std::max(1u, uint32_t(rect.height * float(mHeight)));
+    slot.view->setViewport({
+            int32_t(rect.left * float(mWidth)), int32_t(rect.bottom * float(mHeight)),
+            width, height });
+    slot.camera->setProjection(slot.fov, double(width) / height, slot.near, slot.far,
+            Camera::Fov::VERTICAL);
+}
+
+void ViewSet::render(Renderer& renderer) const {
+    for (Slot const& slot : mViews) {
+        renderer.render(slot.view);
+    }
+}
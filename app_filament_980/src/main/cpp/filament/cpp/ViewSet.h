@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_VIEWSET_H
+#define TNT_FILAMENT_SAMPLE_VIEWSET_H
+
+#include <utils/Entity.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace filament {
+class Camera;
+class Engine;
+class Renderer;
+class Scene;
+class View;
+}
+
+/**
+ * The views rendered every frame, all of them looking at the same scene so that transforms are
+ * only updated once. Each view has its own camera and quality options and covers a rectangle of
+ * the window given in fractions of its size, which makes split-screen and picture-in-picture
+ * layouts independent of the window size.
+ *
+ * The first view is the main one, it covers the whole window unless told otherwise and cannot
+ * be removed. Views are rendered in order, so later ones are drawn over the earlier ones.
+ */
+class ViewSet {
+public:
+    // Fractions of the window, from its bottom-left corner.
+    struct Rect {
+        float left = 0.0f;
+        float bottom = 0.0f;
+        float width = 1.0f;
+        float height = 1.0f;
+    };
+
+    ViewSet(filament::Engine& engine, filament::Scene* scene);
+
+    // Destroys every view, along with its camera.
+    ~ViewSet();
+
+    ViewSet(ViewSet const&) = delete;
+    ViewSet& operator=(ViewSet const&) = delete;
+
+    /**
+     * Adds a view drawn over the existing ones. Post-processing is typically turned off for
+     * small inspection views, where it costs more than it brings.
+     *
+     * @return the index of the new view
+     */
+    size_t add(const char* name, Rect rect, bool postProcessing = true);
+
+    // Removes a view other than the main one, the following views move down by one index.
+    void remove(size_t index);
+
+    void setRect(size_t index, Rect rect);
+
+    // Vertical field of view, in degrees, applied along with the aspect ratio of the view.
+    void setProjection(size_t index, double fovInDegrees, double near, double far);
+
+    // Updates every viewport and projection for the new window size.
+    void resize(uint32_t width, uint32_t height);
+
+    // Renders every view, must be called between Renderer::beginFrame() and endFrame().
+    void render(filament::Renderer& renderer) const;
+
+    filament::View* getView(size_t index) const noexcept { return mViews[index].view; }
+    filament::Camera* getCamera(size_t index) const noexcept { return mViews[index].camera; }
+    size_t getCount() const noexcept { return mViews.size(); }
+
+private:
+    struct Slot {
+        filament::View* view;
+        filament::Camera* camera;
+        Rect rect;
+        double fov = 65.0;
+        double near = 0.1;
+        double far = 10.0;
+    };
+
+    void layout(Slot const& slot) const;
+
+    filament::Engine& mEngine;
+    filament::Scene* mScene;
+    std::vector<Slot> mViews;
+    uint32_t mWidth = 0;
+    uint32_t mHeight = 0;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_VIEWSET_H
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "YuvConverter.h"
+
+#include <algorithm>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Full range BT.601 in 1.7 fixed point, the chroma terms fit in 16 bits
+static constexpr int32_t RV = 179;  // 1.402
+static constexpr int32_t GU = -44;  // -0.344
+static constexpr int32_t GV = -91;  // -0.714
+static constexpr int32_t BU = 227;  // 1.772
+
+static inline uint8_t saturate(int32_t value) noexcept {
+    return uint8_t(std::min(std::max(value, 0), 255));
+}
+
+static void convertRow(uint8_t const* yRow, uint8_t const* uRow, uint8_t const* vRow,
+        uint32_t uvPixelStride, uint32_t width, uint8_t* out) noexcept {
+    uint32_t x = 0;
+#if defined(__ARM_NEON)
+    if (uvPixelStride == 1 || uvPixelStride == 2) {
+        // semi-planar chroma is loaded 16 bytes at a time, one more than the samples of the
+        // block: that byte may be past the end of the last row, which the scalar loop finishes
+        uint32_t const end = uvPixelStride == 2 ? width - 1 : width;
+        for (; x + 16 <= end; x += 16) {
+            uint8x16_t const y = vld1q_u8(yRow + x);
+            uint8x8_t u, v;
+            if (uvPixelStride == 1) {
+                u = vld1_u8(uRow + x / 2);
+                v = vld1_u8(vRow + x / 2);
+            } else {
+                u = vld2_u8(uRow + x).val[0];
+                v = vld2_u8(vRow + x).val[0];
+            }
+            int16x8_t const du = vreinterpretq_s16_u16(vsubl_u8(u, vdup_n_u8(128)));
+            int16x8_t const dv = vreinterpretq_s16_u16(vsubl_u8(v, vdup_n_u8(128)));
+
+            int16x8_t const rc = vrshrq_n_s16(vmulq_n_s16(dv, RV), 7);
+            int16x8_t const gc = vrshrq_n_s16(vmlaq_n_s16(vmulq_n_s16(du, GU), dv, GV), 7);
+            int16x8_t const bc = vrshrq_n_s16(vmulq_n_s16(du, BU), 7);
+
+            // each chroma sample covers two pixels
+            int16x8x2_t const r = vzipq_s16(rc, rc);
+            int16x8x2_t const g = vzipq_s16(gc, gc);
+            int16x8x2_t const b = vzipq_s16(bc, bc);
+
+            int16x8_t const y0 = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(y)));
+            int16x8_t const y1 = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(y)));
+
+            uint8x16x4_t rgba;
+            rgba.val[0] = vcombine_u8(vqmovun_s16(vaddq_s16(y0, r.val[0])),
+                    vqmovun_s16(vaddq_s16(y1, r.val[1])));
+            rgba.val[1] = vcombine_u8(vqmovun_s16(vaddq_s16(y0, g.val[0])),
+                    vqmovun_s16(vaddq_s16(y1, g.val[1])));
+            rgba.val[2] = vcombine_u8(vqmovun_s16(vaddq_s16(y0, b.val[0])),
+                    vqmovun_s16(vaddq_s16(y1, b.val[1])));
+            rgba.val[3] = vdupq_n_u8(255);
+            vst4q_u8(out + x * 4, rgba);
+        }
+    }
+#endif
+    // same arithmetic as the vector loop, so that both give the same result
+    for (; x < width; x++) {
+        size_t const c = size_t(x / 2) * uvPixelStride;
+        int32_t const y = yRow[x];
+        int32_t const du = int32_t(uRow[c]) - 128;
+        int32_t const dv = int32_t(vRow[c]) - 128;
+        out[x * 4 + 0] = saturate(y + ((RV * dv + 64) >> 7));
+        out[x * 4 + 1] = saturate(y + ((GU * du + GV * dv + 64) >> 7));
+        out[x * 4 + 2] = saturate(y + ((BU * du + 64) >> 7));
+        out[x * 4 + 3] = 255;
+    }
+}
+
+void YuvConverter::convert(Planes const& planes, uint8_t* rgba) noexcept {
+    size_t const rowSize = size_t(planes.width) * 4;
+    for (uint32_t row = 0; row < planes.height; row++) {
+        size_t const uvOffset = size_t(row / 2) * planes.uvRowStride;
+        convertRow(planes.y + size_t(row) * planes.yRowStride,
+                planes.u + uvOffset, planes.v + uvOffset,
+                planes.uvPixelStride, planes.width, rgba + row * rowSize);
+    }
+}
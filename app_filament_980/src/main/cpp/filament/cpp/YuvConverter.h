@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_YUVCONVERTER_H
+#define TNT_FILAMENT_SAMPLE_YUVCONVERTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * YUV to RGBA conversion of the camera frames given to YuvUploader. Rows are converted 16 pixels
+ * at a time with NEON where available, the scalar code gives the same result.
+ */
+class YuvConverter {
+public:
+    // A YUV_420_888 image, the chroma planes are subsampled by 2 in both directions.
+    struct Planes {
+        uint8_t const* y = nullptr;
+        uint8_t const* u = nullptr;
+        uint8_t const* v = nullptr;
+        uint32_t yRowStride = 0;
+        uint32_t uvRowStride = 0;
+        uint32_t uvPixelStride = 1;     // 1 for planar images, 2 for semi-planar ones
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    // Converts planes to tightly packed RGBA8 (full range BT.601, as the camera produces).
+    static void convert(Planes const& planes, uint8_t* rgba) noexcept;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_YUVCONVERTER_H
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "YuvUploader.h"
+
+#include "MemoryTracker.h"
+#include "PixelBufferPool.h"
+
+#include <filament/Engine.h>
+#include <filament/MaterialInstance.h>
+#include <filament/Texture.h>
+#include <filament/TextureSampler.h>
+
+#include <algorithm>
+#include <chrono>
+
+using namespace filament;
+
+YuvUploader::YuvUploader(Engine& engine) : mEngine(engine) {
+    mThread = std::thread(&YuvUploader::run, this);
+}
+
+YuvUploader::~YuvUploader() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    mCondition.notify_one();
+    mThread.join();
+    release(mJob);
+
+    bool const uploading = std::any_of(std::begin(mBuffers), std::end(mBuffers),
+            [](Buffer const& buffer) { return buffer.state == State::UPLOADING; });
+    if (uploading) {
+        // the driver runs the release callbacks of the buffers it's done with
+        mEngine.flushAndWait();
+    }
+    for (Buffer& buffer : mBuffers) {
+        PixelBufferPool::get().free(buffer.data, buffer.capacity);
+    }
+}
+
+void YuvUploader::release(Job& job) noexcept {
+    if (job.pending && job.release) {
+        job.release(nullptr, job.user);
+    }
+    job = {};
+}
+
+void YuvUploader::push(Planes const& planes, Stream::Callback release, void* user) {
+    Job previous;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        previous = mJob;
+        mJob = { planes, release, user, true };
+        if (previous.pending) {
+            mDropped++;
+        }
+    }
+    mCondition.notify_one();
+    // released outside of the lock, it may call into Java
+    YuvUploader::release(previous);
+}
+
+void YuvUploader::run() {
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mCondition.wait(lock, [this] { return mExit || mJob.pending; });
+        if (mExit) {
+            break;
+        }
+        Job job = mJob;
+        mJob = {};
+
+        Buffer* const buffer = std::find_if(std::begin(mBuffers), std::end(mBuffers),
+                [](Buffer const& buffer) { return buffer.state == State::FREE; });
+        if (buffer == std::end(mBuffers)) {
+            // the engine is lagging behind, it's still holding on to every other buffer
+            mDropped++;
+            lock.unlock();
+            release(job);
+            lock.lock();
+            continue;
+        }
+        buffer->state = State::CONVERTING;
+        lock.unlock();
+
+        auto const start = std::chrono::steady_clock::now();
+        size_t const size = size_t(job.planes.width) * job.planes.height * 4;
+        if (buffer->capacity < size) {
+            // only when the frame size grows
+            PixelBufferPool& pool = PixelBufferPool::get();
+            pool.free(buffer->data, buffer->capacity);
+            buffer->data = (uint8_t*) pool.alloc(size);
+            buffer->capacity = buffer->data ? size : 0;
+        }
+        if (buffer->data) {
+            YuvConverter::convert(job.planes, buffer->data);
+        }
+        std::chrono::duration<float, std::milli> const elapsed =
+                std::chrono::steady_clock::now() - start;
+        release(job);
+
+        lock.lock();
+        if (!buffer->data) {
+            buffer->state = State::FREE;
+            mDropped++;
+            continue;
+        }
+        buffer->width = job.planes.width;
+        buffer->height = job.planes.height;
+        buffer->state = State::READY;
+        if (mReady) {
+            mReady->state = State::FREE;
+            mDropped++;
+        }
+        mReady = buffer;
+        mConverted++;
+        mConvertSumMs += elapsed.count();
+        mConvertMaxMs = std::max(mConvertMaxMs, elapsed.count());
+    }
+}
+
+bool YuvUploader::upload(Texture** texture, MaterialInstance* mi, const char* name) {
+    Buffer* buffer;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        buffer = mReady;
+        if (!buffer) {
+            return false;
+        }
+        mReady = nullptr;
+        buffer->state = State::UPLOADING;
+    }
+
+    Texture* target = *texture;
+    if (!target || target->getTarget() != Texture::Sampler::SAMPLER_2D ||
+            target->getWidth() != buffer->width || target->getHeight() != buffer->height) {
+        target = Texture::Builder()
+                .width(buffer->width)
+                .height(buffer->height)
+                .levels(1)
+                .sampler(Texture::Sampler::SAMPLER_2D)
+                .format(Texture::InternalFormat::RGBA8)
+                .build(mEngine);
+        MemoryTracker::get().track(MemoryTracker::Category::TEXTURES, target,
+                MemoryTracker::getTextureSize(target));
+        // the old texture is only destroyed once nothing samples it anymore
+        mi->setParameter(name, target, TextureSampler(
+                TextureSampler::MagFilter::LINEAR, TextureSampler::WrapMode::CLAMP_TO_EDGE));
+        if (*texture) {
+            MemoryTracker::get().untrack(*texture);
+            mEngine.destroy(*texture);
+        }
+        *texture = target;
+    }
+
+    size_t const size = size_t(buffer->width) * buffer->height * 4;
+    target->setImage(mEngine, 0, Texture::PixelBufferDescriptor(buffer->data, size,
+            Texture::Format::RGBA, Texture::Type::UBYTE, &onBufferReleased, this));
+    mFrames++;
+    return true;
+}
+
+void YuvUploader::onBufferReleased(void* data, size_t, void* user) {
+    YuvUploader* const uploader = static_cast<YuvUploader*>(user);
+    std::lock_guard<std::mutex> lock(uploader->mLock);
+    for (Buffer& buffer : uploader->mBuffers) {
+        // the data of a CONVERTING buffer may be changing, only an UPLOADING one can match
+        if (buffer.state == State::UPLOADING && buffer.data == data) {
+            buffer.state = State::FREE;
+            break;
+        }
+    }
+}
+
+void YuvUploader::clear() noexcept {
+    Job job;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        job = mJob;
+        mJob = {};
+        if (mReady) {
+            mReady->state = State::FREE;
+            mReady = nullptr;
+        }
+    }
+    release(job);
+}
+
+YuvUploader::Stats YuvUploader::resetStats() noexcept {
+    Stats stats;
+    stats.frames = mFrames;
+    mFrames = 0;
+    std::lock_guard<std::mutex> lock(mLock);
+    stats.dropped = mDropped;
+    stats.averageConvertMs = mConverted ? float(mConvertSumMs / mConverted) : 0.0f;
+    stats.maxConvertMs = mConvertMaxMs;
+    mDropped = 0;
+    mConverted = 0;
+    mConvertSumMs = 0.0;
+    mConvertMaxMs = 0.0f;
+    return stats;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_YUVUPLOADER_H
+#define TNT_FILAMENT_SAMPLE_YUVUPLOADER_H
+
+#include "YuvConverter.h"
+
+#include <filament/Stream.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+class Engine;
+class MaterialInstance;
+class Texture;
+}
+
+/**
+ * CPU path for camera frames, used when the stream texture is a plain SAMPLER_2D: YUV_420_888
+ * images (as produced by an ImageReader) are converted to RGBA on a worker thread and uploaded
+ * with Texture::setImage().
+ *
+ * Frames are converted into one of three buffers: one can be held by the engine while it uploads
+ * it, one converted and waiting for the next frame, and one being written by the worker. A buffer
+ * goes back to the pool from the release callback of its PixelBufferDescriptor, so no memory is
+ * allocated once the frame size is stable. Like CameraStream, the most recent frame wins: a frame
+ * replaced before it could be converted or uploaded is dropped.
+ */
+class YuvUploader {
+public:
+    // A YUV_420_888 image, see YuvConverter.
+    using Planes = YuvConverter::Planes;
+
+    struct Stats {
+        uint32_t frames = 0;    // frames uploaded
+        uint32_t dropped = 0;   // replaced by a newer frame before being uploaded
+        float averageConvertMs = 0.0f;
+        float maxConvertMs = 0.0f;
+    };
+
+    explicit YuvUploader(filament::Engine& engine);
+
+    // Stops the worker, and waits for the engine to give back the buffers it still holds.
+    ~YuvUploader();
+
+    YuvUploader(YuvUploader const&) = delete;
+    YuvUploader& operator=(YuvUploader const&) = delete;
+
+    /**
+     * Queues a frame for conversion, release is called once the planes aren't read anymore, or
+     * when the frame is dropped. Can be called from any thread.
+     */
+    void push(Planes const& planes, filament::Stream::Callback release, void* user);
+
+    /**
+     * Uploads the most recent converted frame, if there's a new one, into *texture. The texture
+     * is replaced by a SAMPLER_2D RGBA8 texture of the frame's size if it doesn't match, the
+     * new one is then bound to the sampler parameter name of mi.
+     * Must be called on the render thread.
+     *
+     * @return true if a new frame was uploaded
+     */
+    bool upload(filament::Texture** texture, filament::MaterialInstance* mi, const char* name);
+
+    // Frames pushed but not uploaded yet are dropped.
+    void clear() noexcept;
+
+    // Returns the metrics accumulated since the last call and resets them.
+    Stats resetStats() noexcept;
+
+private:
+    static constexpr size_t BUFFER_COUNT = 3;
+
+    enum class State : uint8_t { FREE, CONVERTING, READY, UPLOADING };
+
+    struct Buffer {
+        uint8_t* data = nullptr;
+        size_t capacity = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        State state = State::FREE;
+    };
+
+    struct Job {
+        Planes planes;
+        filament::Stream::Callback release = nullptr;
+        void* user = nullptr;
+        bool pending = false;
+    };
+
+    static void release(Job& job) noexcept;
+    static void onBufferReleased(void* buffer, size_t size, void* user);
+
+    void run();
+
+    filament::Engine& mEngine;
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    Buffer mBuffers[BUFFER_COUNT];  // guarded by mLock, except for the data of a CONVERTING one
+    Job mJob;                       // guarded by mLock
+    Buffer* mReady = nullptr;       // guarded by mLock
+    uint32_t mDropped = 0;          // guarded by mLock
+    uint32_t mConverted = 0;        // guarded by mLock
+    double mConvertSumMs = 0.0;     // guarded by mLock
+    float mConvertMaxMs = 0.0f;     // guarded by mLock
+    bool mExit = false;             // guarded by mLock
+
+    uint32_t mFrames = 0;
+    std::thread mThread;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_YUVUPLOADER_H
@@ -31,17 +31,16 @@ class Skybox;
 }
 
 namespace utils {
+    class AssetSource;
     class Path;
 }
 
-class AAssetManager;
-
 class IBL {
 public:
     explicit IBL(filament::Engine& engine);
     ~IBL();
 
-    bool loadFromDirectory(AAssetManager *assetManager, const utils::Path& path);
+    bool loadFromDirectory(utils::AssetSource const& source, const utils::Path& path);
 
     const filament::IndirectLight* getIndirectLight() const noexcept {
         return mIndirectLight;
@@ -53,7 +52,7 @@ public:
 
 private:
     bool loadCubemapLevel(filament::Texture **texture,
-                          AAssetManager *assetManager, const utils::Path &path,
+                          utils::AssetSource const& source, const utils::Path &path,
                           size_t level = 0, std::string const &levelPrefix = "") const;
 
     filament::Engine& mEngine;
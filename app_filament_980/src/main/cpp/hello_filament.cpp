@@ -14,18 +14,23 @@
  * limitations under the License.
  */
 
+#include <dlfcn.h>
 #include <math.h>
 #include <stdint.h>
 #include <string.h>
+#include <algorithm>
+#include <memory>
 #include <vector>
 #include <iostream>
 #include <fstream>
+#include <utility>
 
 #include <jni.h>
 
 #include <android/native_window_jni.h>
 #include <android/asset_manager.h>
 #include <android/asset_manager_jni.h>
+#include <android/hardware_buffer_jni.h>
 #include <android/log.h>
 
 #include <filament/Box.h>
@@ -52,6 +57,8 @@
 #include <filament/Viewport.h>
 #include <filament/IndirectLight.h>
 
+#include <tsl/robin_map.h>
+
 #include <math/mat4.h>
 #include <math/vec3.h>
 
@@ -62,8 +69,26 @@
 #include <math/mat2.h>
 
 #include "filament/includes/ibl/IBL.h"
+#include "filament/cpp/MaterialRegistry.h"
+#include "filament/cpp/MemoryTracker.h"
+#include "filament/cpp/CameraStream.h"
+#include "filament/cpp/CommandRing.h"
+#include "filament/cpp/Etc2Encoder.h"
+#include "filament/cpp/FrameArena.h"
+#include "filament/cpp/FramePacer.h"
+#include "filament/cpp/LoadCompletion.h"
+#include "filament/cpp/PixelBufferPool.h"
+#include "filament/cpp/RedrawTracker.h"
+#include "filament/cpp/ResidencyManager.h"
+#include "filament/cpp/ResolutionController.h"
+#include "filament/cpp/TextureDownscaler.h"
+#include "filament/cpp/ViewSet.h"
+#include "filament/cpp/YuvUploader.h"
+#include "android/AssetBundle.h"
+#include "android/AssetSource.h"
 #include "android/Path.h"
 #include "android/NioUtils.h"
+#include "android/CallbackUtils.h"
 
 #include "stb_image.h"
 
@@ -86,18 +111,48 @@ static float g_angle = 0;
 static Engine* g_engine = nullptr;
 static Renderer* g_renderer = nullptr;
 static SwapChain* g_swapChain = nullptr;
+static CameraStream* g_stream_source = nullptr;
+// g_stream_source's stream, if any
 static Stream* g_camera_stream = nullptr;
-
+// CPU path for camera frames, used instead of a stream when the stream texture is a SAMPLER_2D
+static YuvUploader* g_uploader = nullptr;
+static bool g_camera_frames = false;
+static MaterialRegistry* g_materials = nullptr;
+static CommandRing g_commands;
+static RedrawTracker g_redraw;
+// Assets looked up here first, the loaders fall back to the APK
+static AssetBundle* g_bundle = nullptr;
 
 static const Material* g_default_material = nullptr;
 static MaterialInstance* g_default_mi = nullptr;
 
+// Meshes with maps get their own instance of it, recycled through g_materials' pool
 static const Material* g_textured_material = nullptr;
-static MaterialInstance* g_textured_mi = nullptr;
 
 static const Material* g_camera_material = nullptr;
 static MaterialInstance* g_camera_mi = nullptr;
 
+// Handles of the parameters driven from the UI, resolved once per material in init()
+struct MaterialHandles {
+    MaterialParameters* parameters = nullptr;
+    MaterialParameters::Handle metallic = MaterialParameters::INVALID;
+    MaterialParameters::Handle roughness = MaterialParameters::INVALID;
+    MaterialParameters::Handle clearCoat = MaterialParameters::INVALID;
+    MaterialParameters::Handle albedo = MaterialParameters::INVALID;
+};
+static MaterialHandles g_default_handles;
+static MaterialHandles g_camera_handles;
+// the textured material scales its metallic and roughness maps by the UI values
+static MaterialHandles g_textured_handles;
+// Last values driven from the UI, given to the textured instances acquired from then on
+static float3 g_material_settings{ 1.0f, 0.7f, 0.0f };
+// Material parameter updates made during the last rendered frame
+static MaterialParameters::Stats g_material_stats;
+
+// Loads whose buffers are still in flight, by id, polled from Java with isLoadComplete()
+static std::vector<std::pair<jint, LoadCompletion*>> g_loads;
+static jint g_next_load_id = 1;
+
 static Scene* g_scene = nullptr;
 gltfio::FilamentAsset* filamentAsset;
 static Entity currentModel;
@@ -106,14 +161,30 @@ static Entity g_light1;
 static Entity g_light2;
 static Entity g_light3;
 static Entity g_light4;
+// stays null while the IBL loading of loadIbl() is commented out
 static IBL* g_ibl = nullptr;
 
+// Every view rendered each frame, g_view and g_camera are the main one
+static ViewSet* g_views = nullptr;
 static View* g_view = nullptr;
 static Camera* g_camera = nullptr;
+static ResolutionController* g_resolution = nullptr;
+static FramePacer* g_pacer = nullptr;
+// Scratch memory of the render loop
+static FrameArena* g_frame_arena = nullptr;
+// Shrinks the maps loaded with a mesh to the device's texture budget
+static TextureDownscaler g_texture_downscaler;
+// Compresses the RGBA maps loaded with a mesh, unless disabled
+static Etc2Encoder g_etc2_encoder;
+static bool g_compress_textures = true;
 
 struct Mesh;
 static constexpr size_t MESH_COUNT = 1;
 static std::vector<Mesh *> g_meshes;
+// Every mesh loaded so far by name, the ones not shown stay around until evicted by g_residency
+static tsl::robin_map<std::string, Mesh*> g_mesh_cache;
+static ResidencyManager* g_residency = nullptr;
+static constexpr size_t DEFAULT_GPU_BUDGET = 192 * 1024 * 1024;
 
 struct Header {
     uint32_t version;
@@ -150,41 +221,447 @@ struct Mesh {
     Entity renderable;
     VertexBuffer* vertexBuffer = nullptr;
     IndexBuffer* indexBuffer = nullptr;
-    Texture* textures[5] = {nullptr, nullptr, nullptr, nullptr};
+    Texture* textures[5] = {nullptr, nullptr, nullptr, nullptr, nullptr}; // see TEXTURE_MAPS
+    Texture* camera = nullptr; // what the camera feed is streamed or uploaded to
+    size_t bufferSize = 0; // vertex and index data
+    // instance of g_textured_material sampling the textures, if they could all be loaded
+    MaterialInstance* textured = nullptr;
 };
 
-static void setParameterFromAsset(Texture **texture, AAssetManager *assetManager, const Path &path,
-                                  std::string name, TextureSampler const &sampler,
-                                  Texture::InternalFormat internalFormat);
+// Material a mesh is shown with when there's no camera feed on it.
+static MaterialInstance* getMeshMaterial(Mesh const* mesh) {
+    return mesh->textured ? mesh->textured : g_default_mi;
+}
 
-static Mesh* decodeMesh(void const* data, off_t offset, MaterialInstance* mi);
+// Loads the PBR maps stored next to a mesh in the background, see MapLoad.
+static void setParametersFromAssets(Mesh* mesh, AssetSource const& source, const Path& path,
+                                    TextureSampler const& sampler);
+
+// The mesh buffers are tracked by completion if there's one, otherwise data must be kept alive
+// until the engine has consumed them.
+static Mesh* decodeMesh(void const* data, off_t offset, MaterialInstance* mi,
+                        LoadCompletion* completion = nullptr);
+
+// A map ready to be uploaded, prepared by a worker: pixels decoded in a buffer of the pixel buffer
+// pool (released with stbi_image_free), or ETC2 blocks allocated from the pool.
+struct EncodedMap {
+    void* data = nullptr;
+    size_t size = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    Texture::InternalFormat internalFormat = Texture::InternalFormat::RGBA8;
+    bool compressed = false;
+    Texture::CompressedType compressedType = Texture::CompressedType::ETC2_RGB8;
+};
 
-static Texture *decodeTexture(void const *data, off_t len, Texture::InternalFormat internalFormat);
+static Texture* createTexture(EncodedMap const& map);
+static void freeMap(EncodedMap& map);
+
+// The maps of a mesh, decoded, downscaled and compressed by the workers of g_texture_downscaler
+// so that loading a mesh doesn't wait for them. The mesh keeps the default material until they
+// are all done, then each map is shown from its preview until its full image is uploaded.
+struct MapLoad {
+    Mesh* mesh;
+    AssetSource::Asset assets[5]; // see TEXTURE_MAPS, read by the workers
+    // written by the workers until the batch is done
+    EncodedMap previews[5];
+    EncodedMap maps[5];
+    std::shared_ptr<TextureDownscaler::Batch> batch;
+    TextureSampler sampler;
+};
+static std::vector<std::unique_ptr<MapLoad>> g_map_loads;
+
+// A map of a mesh shown from a preview until its full resolution version is uploaded
+struct PendingMap {
+    Mesh* mesh;
+    size_t index; // in TEXTURE_MAPS
+    EncodedMap map;
+    TextureSampler sampler;
+};
+static std::vector<PendingMap> g_pending_maps;
+// the shortest side of the previews
+static constexpr uint32_t PREVIEW_SIZE = 64;
+// Bytes of full resolution maps uploaded per frame, a larger map is uploaded on its own
+static constexpr size_t MAP_UPLOAD_BUDGET = 4 * 1024 * 1024;
 
 
 static void destroyMesh(Mesh *mesh) {
+    auto loads = std::remove_if(g_map_loads.begin(), g_map_loads.end(),
+            [mesh](std::unique_ptr<MapLoad> const& load) {
+        if (load->mesh != mesh) {
+            return false;
+        }
+        // the workers may still be writing its maps
+        g_texture_downscaler.wait(*load->batch);
+        for (size_t i = 0; i < std::size(load->maps); i++) {
+            freeMap(load->previews[i]);
+            freeMap(load->maps[i]);
+        }
+        return true;
+    });
+    g_map_loads.erase(loads, g_map_loads.end());
+
+    auto pending = std::remove_if(g_pending_maps.begin(), g_pending_maps.end(),
+            [mesh](PendingMap& map) {
+        if (map.mesh != mesh) {
+            return false;
+        }
+        freeMap(map.map);
+        return true;
+    });
+    g_pending_maps.erase(pending, g_pending_maps.end());
+
+    MemoryTracker& tracker = MemoryTracker::get();
+    tracker.untrack(mesh->vertexBuffer);
+    tracker.untrack(mesh->indexBuffer);
     g_engine->destroy(mesh->vertexBuffer);
     g_engine->destroy(mesh->indexBuffer);
     g_engine->destroy(mesh->renderable);
     EntityManager::get().destroy(mesh->renderable);
 
-    for (auto &texture : mesh->textures) {
+    // back to the pool before its textures go away, it's rebound when reused
+    if (mesh->textured) {
+        g_materials->releaseInstance(mesh->textured);
+        mesh->textured = nullptr;
+    }
+
+    auto destroyTexture = [&tracker](Texture*& texture) {
         if (texture) {
+            tracker.untrack(texture);
             g_engine->destroy(texture);
             texture = nullptr;
         }
+    };
+    for (auto &texture : mesh->textures) {
+        destroyTexture(texture);
     }
+    destroyTexture(mesh->camera);
 }
 
-static void destroyMeshes() {
+// Estimated GPU size of a mesh, textures included; the camera texture changes size over time.
+static size_t getMeshSize(Mesh const* mesh) {
+    size_t size = mesh->bufferSize;
+    for (Texture const* texture : mesh->textures) {
+        if (texture) {
+            size += MemoryTracker::getTextureSize(texture);
+        }
+    }
+    return size + MemoryTracker::getTextureSize(mesh->camera);
+}
+
+// Removes the current meshes from the scene, they're kept in g_mesh_cache.
+static void hideMeshes() {
     for (Mesh *mesh : g_meshes) {
         g_scene->remove(mesh->renderable);
-        destroyMesh(mesh);
-        delete mesh;
     }
     g_meshes.clear();
 }
 
+// Called by g_residency on a mesh that isn't shown.
+static void evictMesh(void const* key) {
+    for (auto iter = g_mesh_cache.begin(); iter != g_mesh_cache.end(); ++iter) {
+        if (iter->second == key) {
+            Mesh* mesh = iter->second;
+            g_mesh_cache.erase(iter);
+            destroyMesh(mesh);
+            delete mesh;
+            // the slabs that held its pending maps aren't needed anymore
+            PixelBufferPool::get().trim();
+            return;
+        }
+    }
+}
+
+static void destroyMeshes() {
+    hideMeshes();
+    for (auto const& cached : g_mesh_cache) {
+        g_residency->remove(cached.second);
+        destroyMesh(cached.second);
+        delete cached.second;
+    }
+    g_mesh_cache.clear();
+}
+
+static MaterialHandles resolveHandles(const Material* material) {
+    MaterialHandles handles;
+    MaterialParameters& parameters = g_materials->getParameters(material);
+    handles.parameters = &parameters;
+    handles.metallic = parameters.getHandle("metallic");
+    handles.roughness = parameters.getHandle("roughness");
+    handles.clearCoat = parameters.getHandle("clearCoat");
+    handles.albedo = parameters.getHandle("albedo");
+    // the textured material samples maps of these names and has factors for them instead
+    if (handles.metallic == MaterialParameters::INVALID) {
+        handles.metallic = parameters.getHandle("metallicFactor");
+    }
+    if (handles.roughness == MaterialParameters::INVALID) {
+        handles.roughness = parameters.getHandle("roughnessFactor");
+    }
+    // albedo is only a color on the default material, the others sample it
+    if (handles.metallic == MaterialParameters::INVALID ||
+            handles.roughness == MaterialParameters::INVALID ||
+            handles.clearCoat == MaterialParameters::INVALID) {
+        LOGD("WARNING: %s lacks some of the parameters driven from the UI, they're ignored",
+                material->getName());
+    }
+    return handles;
+}
+
+static void setMaterialSettings(MaterialInstance* mi, MaterialHandles const& handles) {
+    MaterialParameters& parameters = *handles.parameters;
+    parameters.set(mi, handles.metallic, g_material_settings.x);
+    parameters.set(mi, handles.roughness, g_material_settings.y);
+    parameters.set(mi, handles.clearCoat, g_material_settings.z);
+}
+
+static void updateMaterial(float metallic, float roughness, float clearCoat) {
+    g_material_settings = float3{ metallic, roughness, clearCoat };
+    bool const camera = g_camera_stream || g_camera_frames;
+    setMaterialSettings(camera ? g_camera_mi : g_default_mi,
+            camera ? g_camera_handles : g_default_handles);
+    // the meshes with maps, cached ones too so that they don't change when shown again
+    for (auto const& cached : g_mesh_cache) {
+        if (cached.second->textured) {
+            setMaterialSettings(cached.second->textured, g_textured_handles);
+        }
+    }
+}
+
+static void updateMaterialAlbedo(float r, float g, float b) {
+    MaterialInstance *mi = g_default_mi;
+    MaterialParameters& parameters = *g_default_handles.parameters;
+    parameters.set(mi, g_default_handles.albedo, Color::toLinear<ACCURATE>(sRGBColor{r, g, b}));
+}
+
+static void updateTransform() {
+    g_redraw.invalidate(RedrawTracker::TRANSFORM);
+    /* Kotlin Base Code
+        val tm = engine.transformManager
+        var center = asset.boundingBox.center.let { v-> Float3(v[0], v[1], v[2]) }
+        val halfExtent = asset.boundingBox.halfExtent.let { v-> Float3(v[0], v[1], v[2]) }
+        val maxExtent = 2.0f * max(halfExtent)
+        val scaleFactor = 2.0f / maxExtent
+        center -= centerPoint / scaleFactor
+        val transform = scale(Float3(scaleFactor)) * translation(-center)
+        tm.setTransform(tm.getInstance(asset.root), transpose(transform).toFloatArray())
+     */
+    if(filamentAsset){
+        TransformManager* tm = &g_engine->getTransformManager();
+        auto boundingBoxCenter = filamentAsset->getBoundingBox().center();
+        auto center = float3{boundingBoxCenter[0],boundingBoxCenter[1],boundingBoxCenter[2]};
+        auto halfExtent = filamentAsset->getBoundingBox().extent(); // Todo: max of it
+        float max = 0.0;
+        //max of halfExtent
+        if(halfExtent[0] > halfExtent[1] && halfExtent[0] > halfExtent[2]){
+            max = halfExtent[0];
+        }
+        if(halfExtent[1] > halfExtent[0] && halfExtent[1] > halfExtent[2]){
+            max = halfExtent[1];
+        }
+        if(halfExtent[2] > halfExtent[0] && halfExtent[2] > halfExtent[1]){
+            max = halfExtent[2];
+        }
+
+        float maxExtent = 2.0f * max;
+        float scaleFactor = 2.0f / maxExtent;
+        float3 centerPoint = float3{0,0,-4};//defaults to < 0, 0, -4 >
+
+        center -= (centerPoint / scaleFactor);
+
+        auto scaleAsFloat3 = float3{scaleFactor, scaleFactor, scaleFactor};
+        //mat4f boundingBoxCenterAsMat4 = mat4f{float4{-center,1}};
+        auto scaling = mat4f::scaling(scaleAsFloat3);
+        auto translation = mat4f::translation(-center);
+        auto transform = scaling * translation;
+        auto transposeMat = transpose(transform);
+
+        tm->setTransform(tm->getInstance(filamentAsset->getRoot()), transposeMat);
+        auto checkTransform = tm->getTransform(tm->getInstance(filamentAsset->getRoot()));
+        auto asFloatArray = checkTransform.asArray();
+
+        auto camPos = g_camera->getPosition();
+        auto camProjMat = g_camera->getProjectionMatrix();
+        camPos;
+        camProjMat;
+
+    }
+}
+
+static void executeCommand(CommandRing::Command command, float const* args, size_t count) {
+    switch (command) {
+        case CommandRing::Command::UPDATE_MATERIAL:
+            if (count >= 3) updateMaterial(args[0], args[1], args[2]);
+            break;
+        case CommandRing::Command::UPDATE_MATERIAL_ALBEDO:
+            if (count >= 3) updateMaterialAlbedo(args[0], args[1], args[2]);
+            break;
+        case CommandRing::Command::UPDATE_TRANSFORM:
+            updateTransform();
+            break;
+        default:
+            break;
+    }
+}
+
+struct QueuedCommand {
+    static constexpr size_t MAX_ARGS = 3;
+    CommandRing::Command command;
+    uint32_t count;
+    float args[MAX_ARGS];
+    bool superseded;
+};
+
+// Runs the commands published since the last frame, a command followed by another one of the
+// same kind is superseded by it and skipped (all of them replace state).
+static void drainCommands(FrameArena& arena) {
+    FrameArena::vector<QueuedCommand> commands = arena.makeVector<QueuedCommand>();
+    g_commands.drain([&commands](CommandRing::Command command, float const* args, size_t count) {
+        QueuedCommand queued{ command, uint32_t(std::min(count, QueuedCommand::MAX_ARGS)) };
+        std::copy_n(args, queued.count, queued.args);
+        commands.push_back(queued);
+    });
+
+    uint32_t seen = 0;
+    for (auto iter = commands.rbegin(); iter != commands.rend(); ++iter) {
+        uint32_t const bit = 1u << (uint32_t(iter->command) & 31u);
+        iter->superseded = (seen & bit) != 0;
+        seen |= bit;
+    }
+    for (QueuedCommand const& queued : commands) {
+        if (!queued.superseded) {
+            executeCommand(queued.command, queued.args, queued.count);
+        }
+    }
+}
+
+// Replaces the current meshes with the one stored at name. Returns right away, the returned
+// completion (owned by the caller) tells when the engine is done uploading the mesh. Returns
+// nullptr if the mesh is still resident from a previous load, there is nothing to wait for then.
+static LoadCompletion* loadMesh(AssetSource const& source, const char* name) {
+    auto cached = g_mesh_cache.find(name);
+    if (cached != g_mesh_cache.end()) {
+        Mesh* mesh = cached->second;
+        hideMeshes();
+        // back to the state of a fresh load
+        auto& rcm = g_engine->getRenderableManager();
+        rcm.setMaterialInstanceAt(rcm.getInstance(mesh->renderable), 0, getMeshMaterial(mesh));
+        g_scene->addEntity(mesh->renderable);
+        g_meshes.push_back(mesh);
+        return nullptr;
+    }
+
+    AssetSource::Asset asset = source.open(name);
+    if (!asset) {
+        return nullptr;
+    }
+    void const* data = asset.getData();
+    LoadCompletion* completion = LoadCompletion::create(std::move(asset));
+
+    hideMeshes();
+    Mesh* mesh = decodeMesh(data, 0, g_default_mi, completion);
+    completion->seal();
+    if (mesh) {
+        mesh->camera = Texture::Builder()
+                .sampler(STREAM_SAMPLER_TYPE)
+                .format(Texture::InternalFormat::RGBA8)
+                .build(*g_engine);
+        MemoryTracker::get().track(MemoryTracker::Category::TEXTURES, mesh->camera,
+                MemoryTracker::getTextureSize(mesh->camera));
+
+        // the maps are next to the mesh, it's shown with the default material until they load
+        TextureSampler sampler(
+                TextureSampler::MagFilter::LINEAR, TextureSampler::WrapMode::REPEAT);
+        setParametersFromAssets(mesh, source, Path(name).getParent(), sampler);
+        auto& rcm = g_engine->getRenderableManager();
+        rcm.setMaterialInstanceAt(rcm.getInstance(mesh->renderable), 0, getMeshMaterial(mesh));
+
+        g_meshes.push_back(mesh);
+        g_mesh_cache[name] = mesh;
+        g_residency->add(mesh, getMeshSize(mesh));
+    }
+    return completion;
+}
+
+static jint trackLoad(LoadCompletion* completion) {
+    if (!completion) {
+        return 0;
+    }
+    jint const id = g_next_load_id++;
+    g_loads.emplace_back(id, completion);
+    return id;
+}
+
+// Forgets about the loads the engine is done with, or about all of them. Returns whether there
+// were any.
+static bool retireLoads(bool all) {
+    auto last = std::remove_if(g_loads.begin(), g_loads.end(), [all](auto const& load) {
+        if (all || load.second->isComplete()) {
+            load.second->release();
+            return true;
+        }
+        return false;
+    });
+    bool const retired = last != g_loads.end();
+    g_loads.erase(last, g_loads.end());
+    if (retired) {
+        // the engine is done with their buffers, the slabs left empty are freed
+        PixelBufferPool::get().trim();
+    }
+    return retired;
+}
+
+// Shows stream on the first mesh, or goes back to its default material when stream is null.
+static void bindCameraStream(Stream* stream) {
+    if (!stream) {
+        g_stream_source->destroy();
+    }
+    g_camera_stream = stream;
+    g_camera_frames = false;
+    g_uploader->clear();
+    if (g_meshes.empty()) {
+        return;
+    }
+    if (stream) {
+        g_meshes[0]->camera->setExternalStream(*g_engine, stream);
+        g_camera_mi->setParameter("albedo", g_meshes[0]->camera,
+                TextureSampler(TextureSampler::MagFilter::LINEAR,
+                        TextureSampler::WrapMode::CLAMP_TO_EDGE));
+    }
+    auto& rcm = g_engine->getRenderableManager();
+    rcm.setMaterialInstanceAt(
+            rcm.getInstance(g_meshes[0]->renderable), 0,
+            stream ? g_camera_mi : getMeshMaterial(g_meshes[0]));
+}
+
+// Shows the frames pushed to g_uploader on the first mesh, or goes back to its default material.
+static void bindCameraFrames(bool enabled) {
+    bindCameraStream(nullptr);
+    g_camera_frames = enabled;
+    if (g_meshes.empty()) {
+        return;
+    }
+    if (enabled) {
+        // g_uploader rebinds it whenever a frame of another size replaces the texture
+        g_camera_mi->setParameter("albedo", g_meshes[0]->camera,
+                TextureSampler(TextureSampler::MagFilter::LINEAR,
+                        TextureSampler::WrapMode::CLAMP_TO_EDGE));
+    }
+    auto& rcm = g_engine->getRenderableManager();
+    rcm.setMaterialInstanceAt(
+            rcm.getInstance(g_meshes[0]->renderable), 0,
+            enabled ? g_camera_mi : getMeshMaterial(g_meshes[0]));
+}
+
+// AHardwareBuffer_fromHardwareBuffer() is only in API 26, it's looked up at runtime so that the
+// acquired camera stream is available where the device has it, whatever minSdkVersion is.
+using FromHardwareBuffer = AHardwareBuffer* (*)(JNIEnv* env, jobject hardwareBuffer);
+
+static FromHardwareBuffer getFromHardwareBuffer() {
+    static FromHardwareBuffer const sFromHardwareBuffer = (FromHardwareBuffer) dlsym(
+            RTLD_DEFAULT, "AHardwareBuffer_fromHardwareBuffer");
+    return sFromHardwareBuffer;
+}
+
 static std::ifstream::pos_type getFileSize(const char* filename) {
     std::ifstream in(filename, std::ifstream::ate | std::ifstream::binary);
     return in.tellg();
@@ -193,11 +670,34 @@ static std::ifstream::pos_type getFileSize(const char* filename) {
 
 extern "C" {
 
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void*) {
+    JNIEnv* env;
+    if (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) != JNI_OK) {
+        return JNI_ERR;
+    }
+
+    // Class and method lookups are done once here instead of on every buffer or callback
+    AutoBuffer::init(env);
+    initCallbackJni(env);
+
+    return JNI_VERSION_1_6;
+}
+
+JNIEXPORT void JNICALL JNI_OnUnload(JavaVM* vm, void*) {
+    JNIEnv* env;
+    if (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) == JNI_OK) {
+        terminateCallbackJni(env);
+        AutoBuffer::terminate(env);
+    }
+}
+
 JNIEXPORT void JNICALL
 Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_loadIbl(JNIEnv *env, jclass type,
                                                               jobject assets, jstring name_) {
+    g_redraw.invalidate(RedrawTracker::CONTENT);
 /*
-    AAssetManager *assetManager = AAssetManager_fromJava(env, assets);
+    AAssetSource apk(AAssetManager_fromJava(env, assets));
+    BundleSource source(g_bundle, apk);
     const char *name = env->GetStringUTFChars(name_, 0);
 
     // IBL
@@ -210,7 +710,7 @@ Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_loadIbl(JNIEnv *env, jcl
     }
 
     g_ibl = new IBL(*g_engine);
-    bool isLoadSuccess = g_ibl->loadFromDirectory(assetManager, name);
+    bool isLoadSuccess = g_ibl->loadFromDirectory(source, name);
     if (!isLoadSuccess) {
         delete g_ibl;
         g_ibl = nullptr;
@@ -248,6 +748,7 @@ Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_loadIbl(JNIEnv *env, jcl
 JNIEXPORT void JNICALL
 Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_loadGlbModel(JNIEnv *env, jclass type,
                                                                 jobject assets, jstring assetName) {
+    g_redraw.invalidate(RedrawTracker::CONTENT);
     /**Grisha way*/
     /*
         Path filename(path);
@@ -285,21 +786,30 @@ Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_loadGlbModel(JNIEnv *env
 extern "C"
 JNIEXPORT void JNICALL
 Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_loadGlbModelWith(JNIEnv *env, jclass clazz, jobject buffer, jint remaining) {
+    g_redraw.invalidate(RedrawTracker::CONTENT);
     // TODO: implement loadGlbModelWith()
     if (filamentAsset && currentModel) {
         filamentAsset->releaseSourceData();
         g_scene->remove(currentModel);
         g_engine->destroy(currentModel);
+        MemoryTracker::get().untrack(filamentAsset);
         filamentAsset = nullptr;
     }
 
     //Create Asset Loader
+    // glb files carry RGB normal maps, only the RG8 maps of meshes need Z reconstructed
     gltfio::MaterialProvider* materialProvider = gltfio::createUbershaderLoader(g_engine);
     AssetLoader* loader = gltfio::AssetLoader::create({g_engine, materialProvider, nullptr});
 
     //Transofrm Buffer to Entities
-    AutoBuffer buffer_auto(env, buffer, remaining);
-    filamentAsset = loader->createAssetFromBinary((const uint8_t *) buffer_auto.getData(), buffer_auto.getSize());
+    {
+        // the loader keeps its own copy of the glb, the Java buffer is released right away
+        AutoBuffer buffer_auto(env, buffer, remaining);
+        filamentAsset = loader->createAssetFromBinary((const uint8_t *) buffer_auto.getData(), buffer_auto.getSize());
+        // the asset's buffers and textures all come from the glb
+        MemoryTracker::get().track(MemoryTracker::Category::ASSETS, filamentAsset,
+                buffer_auto.getSize());
+    }
     gltfio::ResourceLoader({.engine = g_engine, .normalizeSkinningWeights = false, .recomputeBoundingBoxes = false})
             .loadResources(filamentAsset);
 
@@ -322,7 +832,7 @@ Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_loadGlbModelWith(JNIEnv
         const void* data = AAsset_getBuffer(asset);
         if (data) {
             //destroyMeshes();
-            Mesh* mesh = decodeMesh(data, 0, g_textured_mi);
+            Mesh* mesh = decodeMesh(data, 0, g_default_mi);
             gltfio::AssetLoader* assetLoader = gltfio::AssetLoader::create({
                                                                                    g_engine, materialProvider, nullptr
                                                                            });
@@ -336,11 +846,7 @@ Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_loadGlbModelWith(JNIEnv
             // now load textures...
             const Path p(path);
             TextureSampler sampler(TextureSampler::MagFilter::LINEAR, TextureSampler::WrapMode::CLAMP_TO_EDGE);
-            setParameterFromAsset(&mesh->textures[0], assetManager, p, "albedo", sampler, Texture::InternalFormat::SRGB8_A8);
-            setParameterFromAsset(&mesh->textures[1], assetManager, p, "metallic", sampler, Texture::InternalFormat::R8);
-            setParameterFromAsset(&mesh->textures[2], assetManager, p, "roughness", sampler, Texture::InternalFormat::R8);
-            setParameterFromAsset(&mesh->textures[3], assetManager, p, "normal", sampler, Texture::InternalFormat::RGBA8);
-            setParameterFromAsset(&mesh->textures[4], assetManager, p, "ao", sampler, Texture::InternalFormat::R8);
+            setParametersFromAssets(mesh, assetManager, p, sampler);
 }
 
         Fence::waitAndDestroy(g_engine->createFence());
@@ -351,98 +857,338 @@ Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_loadGlbModelWith(JNIEnv
 
 }
 
-void setParameterFromAsset(Texture **texture, AAssetManager *assetManager, const Path &path,
-                           std::string name, TextureSampler const &sampler,
-                           Texture::InternalFormat internalFormat) {
-    Path p(Path::concat(path, name + ".png"));
-    AAsset* asset = AAssetManager_open(assetManager, p.getPath().c_str(), AASSET_MODE_RANDOM);
-    if (asset) {
-        const void *data = AAsset_getBuffer(asset);
-        if (data) {
-            *texture = decodeTexture(data, AAsset_getLength(asset), internalFormat);
-            g_textured_mi->setParameter(name.c_str(), *texture, sampler);
-        }
-        AAsset_close(asset);
-    }
-}
-
-Texture *decodeTexture(void const *data, off_t len, Texture::InternalFormat internalFormat) {
-    int w, h, n;
+// The maps of the textured material, Mesh::textures follows this order. Normal maps are stored
+// as RG8, only g_textured_material samples them and it reconstructs Z.
+static const struct {
+    const char* name;
+    Texture::InternalFormat format;
+    TextureDownscaler::Importance importance;
+} TEXTURE_MAPS[] = {
+        { "albedo",    Texture::InternalFormat::SRGB8_A8, TextureDownscaler::Importance::HIGH },
+        { "metallic",  Texture::InternalFormat::R8,       TextureDownscaler::Importance::MEDIUM },
+        { "roughness", Texture::InternalFormat::R8,       TextureDownscaler::Importance::MEDIUM },
+        { "normal",    Texture::InternalFormat::RG8,      TextureDownscaler::Importance::HIGH },
+        { "ao",        Texture::InternalFormat::R8,       TextureDownscaler::Importance::LOW },
+};
 
-    int c = 0;
-    Texture::Format format;
+static Texture::Format getPixelFormat(Texture::InternalFormat internalFormat, uint8_t* channels) {
     switch (internalFormat) {
         case Texture::InternalFormat::RGBA8:
-            format = Texture::Format::RGBA;
-            c = 4;
-            break;
+            *channels = 4;
+            return Texture::Format::RGBA;
         case Texture::InternalFormat::SRGB8:
         case Texture::InternalFormat::RGB8:
-            format = Texture::Format::RGB;
             LOGD("WARNING: Some Filament backends do not yet support 3-component textures.");
-            c = 3;
-            break;
+            *channels = 3;
+            return Texture::Format::RGB;
+        case Texture::InternalFormat::RG8:
+            *channels = 2;
+            return Texture::Format::RG;
         case Texture::InternalFormat::R8:
-            format = Texture::Format::R;
-            c = 1;
-            break;
+            *channels = 1;
+            return Texture::Format::R;
         default:
-            format = Texture::Format::RGBA;
-            c = 4;
+            *channels = 4;
+            return Texture::Format::RGBA;
+    }
+}
+
+// Keeps the X and Y of the RGB tangent-space normals of an image, in place. The normals are
+// renormalized first so that Z can be reconstructed from the other two.
+static void packNormals(TextureDownscaler::Image& image) {
+    uint8_t* const pixels = (uint8_t*) image.pixels;
+    size_t const count = size_t(image.width) * image.height;
+    for (size_t i = 0; i < count; i++) {
+        float3 n = float3(pixels[i * 3], pixels[i * 3 + 1], pixels[i * 3 + 2]) * (2.0f / 255.0f)
+                - 1.0f;
+        float const length = std::sqrt(dot(n, n));
+        if (length > 0.0f) {
+            n /= length;
+        }
+        pixels[i * 2 + 0] = uint8_t(std::clamp(n.x * 0.5f + 0.5f, 0.0f, 1.0f) * 255.0f + 0.5f);
+        pixels[i * 2 + 1] = uint8_t(std::clamp(n.y * 0.5f + 0.5f, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+    image.channels = 2;
+}
+
+// Whether the device samples ETC2, which every GLES 3.0 one does.
+static bool isEtc2Supported() {
+    for (Texture::InternalFormat format : { Texture::InternalFormat::ETC2_RGB8,
+            Texture::InternalFormat::ETC2_SRGB8, Texture::InternalFormat::ETC2_EAC_RGBA8,
+            Texture::InternalFormat::ETC2_EAC_SRGBA8 }) {
+        if (!Texture::isTextureFormatSupported(*g_engine, format)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Takes the pixels of a decoded image, compressed to ETC2 with encoder if there is one and the
+// image is RGBA. Called on the workers of g_texture_downscaler.
+static EncodedMap encodeMap(TextureDownscaler::Image& image, Texture::InternalFormat internalFormat,
+        Etc2Encoder const* encoder) {
+    EncodedMap map;
+    if (!image.pixels) {
+        return map;
+    }
+    uint8_t channels;
+    getPixelFormat(internalFormat, &channels);
+    map.width = image.width;
+    map.height = image.height;
+    map.internalFormat = internalFormat;
+
+    if (encoder && channels == 4) {
+        uint8_t const* pixels = (uint8_t const*) image.pixels;
+        bool const sRGB = internalFormat == Texture::InternalFormat::SRGB8_A8;
+        // opaque images take half the space without their alpha
+        bool const alpha = !Etc2Encoder::isOpaque(pixels, size_t(image.width) * image.height);
+        size_t const size = Etc2Encoder::getEncodedSize(image.width, image.height, alpha);
+        void* blocks = PixelBufferPool::get().alloc(size);
+        // uploaded uncompressed if the pool has no room for the blocks
+        if (blocks) {
+            encoder->encode(pixels, image.width, image.height, alpha, (uint8_t*) blocks);
+            stbi_image_free(image.pixels);
+            image.pixels = nullptr;
+            map.data = blocks;
+            map.size = size;
+            map.compressed = true;
+            if (alpha) {
+                map.internalFormat = sRGB ? Texture::InternalFormat::ETC2_EAC_SRGBA8
+                                          : Texture::InternalFormat::ETC2_EAC_RGBA8;
+                map.compressedType = sRGB ? Texture::CompressedType::ETC2_EAC_SRGBA8
+                                          : Texture::CompressedType::ETC2_EAC_RGBA8;
+            } else {
+                map.internalFormat = sRGB ? Texture::InternalFormat::ETC2_SRGB8
+                                          : Texture::InternalFormat::ETC2_RGB8;
+                map.compressedType = sRGB ? Texture::CompressedType::ETC2_SRGB8
+                                          : Texture::CompressedType::ETC2_RGB8;
+            }
+            return map;
+        }
     }
 
-    unsigned char* textureData = stbi_load_from_memory((const stbi_uc *) data, (int) len, &w, &h, &n, c);
+    map.data = image.pixels;
+    map.size = size_t(image.width) * image.height * channels;
+    image.pixels = nullptr;
+    return map;
+}
+
+static void freeMap(EncodedMap& map) {
+    if (map.compressed) {
+        PixelBufferPool::get().free(map.data, map.size);
+    } else {
+        stbi_image_free(map.data);
+    }
+    map.data = nullptr;
+}
+
+void setParametersFromAssets(Mesh* mesh, AssetSource const& source, const Path& path,
+                             TextureSampler const& sampler) {
+    // the maps are decoded together so that they share the texture budget
+    constexpr size_t count = std::size(TEXTURE_MAPS);
+    auto load = std::make_unique<MapLoad>();
+    load->mesh = mesh;
+    load->sampler = sampler;
+    std::vector<TextureDownscaler::Image> images(count);
+    for (size_t i = 0; i < count; i++) {
+        load->assets[i] = source.open(
+                Path::concat(path, std::string(TEXTURE_MAPS[i].name) + ".png"));
+        images[i].data = load->assets[i].getData();
+        images[i].size = load->assets[i].getSize();
+        getPixelFormat(TEXTURE_MAPS[i].format, &images[i].channels);
+        if (TEXTURE_MAPS[i].format == Texture::InternalFormat::RG8) {
+            // decoders give luminance and alpha for two channels, normals are packed afterwards
+            images[i].channels = 3;
+        }
+        images[i].sRGB = TEXTURE_MAPS[i].format == Texture::InternalFormat::SRGB8_A8 ||
+                TEXTURE_MAPS[i].format == Texture::InternalFormat::SRGB8;
+        images[i].importance = TEXTURE_MAPS[i].importance;
+    }
+
+    // the workers get a copy of the encoder, its settings can change in the meantime
+    bool const compress = g_compress_textures && isEtc2Supported();
+    MapLoad* const target = load.get();
+    load->batch = g_texture_downscaler.decodeAsync(std::move(images),
+            [target, compress, encoder = g_etc2_encoder](TextureDownscaler::Image& image,
+                    size_t i) {
+        if (!image.pixels) {
+            return;
+        }
+        if (TEXTURE_MAPS[i].format == Texture::InternalFormat::RG8) {
+            packNormals(image);
+        }
+        Etc2Encoder const* etc2 = compress ? &encoder : nullptr;
+        TextureDownscaler::Image preview =
+                g_texture_downscaler.createPreview(image, PREVIEW_SIZE);
+        target->previews[i] = encodeMap(preview, TEXTURE_MAPS[i].format, etc2);
+        target->maps[i] = encodeMap(image, TEXTURE_MAPS[i].format, etc2);
+    });
+    g_map_loads.push_back(std::move(load));
+}
 
-    size_t size = (size_t) (w * h * n);
-    Texture::PixelBufferDescriptor pb(
-            textureData, size,
-            format, Texture::Type::UBYTE,
-            (Texture::PixelBufferDescriptor::Callback) &stbi_image_free);
+Texture* createTexture(EncodedMap const& map) {
+    PixelBufferPool& pool = PixelBufferPool::get();
+    uint8_t channels;
+    Texture::PixelBufferDescriptor pb = map.compressed ?
+            Texture::PixelBufferDescriptor(map.data, map.size, map.compressedType,
+                    uint32_t(map.size), &PixelBufferPool::release, &pool) :
+            Texture::PixelBufferDescriptor(map.data, map.size,
+                    getPixelFormat(map.internalFormat, &channels), Texture::Type::UBYTE,
+                    (Texture::PixelBufferDescriptor::Callback) &stbi_image_free);
 
     Texture* texture = Texture::Builder()
-            .width(uint32_t(w))
-            .height(uint32_t(h))
+            .width(map.width)
+            .height(map.height)
             .sampler(Texture::Sampler::SAMPLER_2D)
-            .format(internalFormat)
+            .format(map.internalFormat)
             .build(*g_engine);
 
     texture->setImage(*g_engine, 0, std::move(pb));
+    MemoryTracker::get().track(MemoryTracker::Category::TEXTURES, texture,
+            MemoryTracker::getTextureSize(texture));
 
     return texture;
 }
 
+// Binds the maps of a load the workers are done with to an instance of g_textured_material,
+// from their previews where they have one.
+static void showMaps(MapLoad& load) {
+    constexpr size_t count = std::size(TEXTURE_MAPS);
+    Mesh* mesh = load.mesh;
+    bool complete = true;
+    for (size_t i = 0; i < count; i++) {
+        complete = complete && load.maps[i].data;
+    }
+    if (!complete) {
+        // the material samples every map, the mesh keeps the default one
+        for (size_t i = 0; i < count; i++) {
+            freeMap(load.previews[i]);
+            freeMap(load.maps[i]);
+        }
+        return;
+    }
 
-JNIEXPORT void JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_loadMesh(
+    for (size_t i = 0; i < count; i++) {
+        if (load.previews[i].data) {
+            mesh->textures[i] = createTexture(load.previews[i]);
+            g_pending_maps.push_back({ mesh, i, load.maps[i], load.sampler });
+        } else {
+            mesh->textures[i] = createTexture(load.maps[i]);
+        }
+    }
+
+    // possibly an instance released by an evicted mesh, all of its samplers are replaced
+    mesh->textured = g_materials->acquireInstance(g_textured_material);
+    setMaterialSettings(mesh->textured, g_textured_handles);
+    for (size_t i = 0; i < count; i++) {
+        mesh->textured->setParameter(TEXTURE_MAPS[i].name, mesh->textures[i], load.sampler);
+    }
+    bool const camera = (g_camera_stream || g_camera_frames) && !g_meshes.empty() &&
+            g_meshes[0] == mesh;
+    if (!camera) {
+        auto& rcm = g_engine->getRenderableManager();
+        rcm.setMaterialInstanceAt(rcm.getInstance(mesh->renderable), 0, getMeshMaterial(mesh));
+    }
+    g_residency->resize(mesh, getMeshSize(mesh));
+}
+
+// Shows the meshes whose maps the workers are done with. Returns false if there were none.
+static bool finishMapLoads() {
+    bool finished = false;
+    for (auto iter = g_map_loads.begin(); iter != g_map_loads.end();) {
+        if (!(*iter)->batch->isDone()) {
+            ++iter;
+            continue;
+        }
+        showMaps(**iter);
+        iter = g_map_loads.erase(iter);
+        finished = true;
+    }
+    return finished;
+}
+
+// Replaces the previews of the oldest pending maps with their full resolution version, up to
+// MAP_UPLOAD_BUDGET bytes. Returns false if there were none.
+static bool uploadPendingMaps() {
+    if (g_pending_maps.empty()) {
+        return false;
+    }
+    size_t uploaded = 0;
+    auto last = g_pending_maps.begin();
+    for (; last != g_pending_maps.end(); ++last) {
+        if (uploaded && uploaded + last->map.size > MAP_UPLOAD_BUDGET) {
+            break;
+        }
+        uploaded += last->map.size;
+
+        Mesh* mesh = last->mesh;
+        Texture* preview = mesh->textures[last->index];
+        mesh->textures[last->index] = createTexture(last->map);
+        if (mesh->textured) {
+            mesh->textured->setParameter(TEXTURE_MAPS[last->index].name,
+                    mesh->textures[last->index], last->sampler);
+        }
+        MemoryTracker::get().untrack(preview);
+        g_engine->destroy(preview);
+        // the mesh was registered with its previews, hidden meshes aren't touched by render()
+        g_residency->resize(mesh, getMeshSize(mesh));
+    }
+    g_pending_maps.erase(g_pending_maps.begin(), last);
+    return true;
+}
+
+JNIEXPORT jint JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_loadMesh(
         JNIEnv* env, jobject type, jobject assets, jstring name_) {
-    AAssetManager *assetManager = AAssetManager_fromJava(env, assets);
+    g_redraw.invalidate(RedrawTracker::CONTENT);
+    AAssetSource apk(AAssetManager_fromJava(env, assets));
+    BundleSource source(g_bundle, apk);
 
     const char* name = env->GetStringUTFChars(name_, 0);
-    AAsset* asset = AAssetManager_open(assetManager, name, AASSET_MODE_RANDOM);
+    jint const id = trackLoad(loadMesh(source, name));
     env->ReleaseStringUTFChars(name_, name);
+    return id;
+}
 
-    char const* data = (char const *) AAsset_getBuffer(asset);
-    if (data) {
-        destroyMeshes();
-        Mesh* mesh = decodeMesh(data, 0, g_default_mi);
-
-        mesh->textures[0] = Texture::Builder()
-                .sampler(STREAM_SAMPLER_TYPE)
-                .format(Texture::InternalFormat::RGBA8)
-                .build(*g_engine);
+JNIEXPORT jboolean JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_isLoadComplete(
+        JNIEnv* env, jobject type, jint id) {
+    auto iter = std::find_if(g_loads.begin(), g_loads.end(), [id](auto const& load) {
+        return load.first == id;
+    });
+    return jboolean(iter == g_loads.end() || iter->second->isComplete());
+}
 
-        TextureSampler sampler(
-                TextureSampler::MagFilter::LINEAR, TextureSampler::WrapMode::CLAMP_TO_EDGE);
-        //g_camera_mi->setParameter("albedo", mesh->textures[0], sampler);
+JNIEXPORT jboolean JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_loadAssetBundle(
+        JNIEnv* env, jobject type, jobject assets, jstring name_) {
+    AAssetSource apk(AAssetManager_fromJava(env, assets));
 
-        g_meshes.push_back(mesh);
+    // pending uploads may still read from the current bundle
+    if (g_bundle && !g_loads.empty()) {
         Fence::waitAndDestroy(g_engine->createFence());
+        retireLoads(true);
     }
-    AAsset_close(asset);
+    delete g_bundle;
+    g_bundle = new AssetBundle();
+
+    const char* name = env->GetStringUTFChars(name_, 0);
+    bool const success = g_bundle->open(apk, name);
+    if (!success) {
+        LOGD("WARNING: %s is not a valid asset bundle", name);
+        delete g_bundle;
+        g_bundle = nullptr;
+    }
+    env->ReleaseStringUTFChars(name_, name);
+    return jboolean(success);
 }
 
-Mesh* decodeMesh(void const* data, off_t offset, MaterialInstance* mi) {
+Mesh* decodeMesh(void const* data, off_t offset, MaterialInstance* mi,
+                 LoadCompletion* completion) {
     const char* p = (const char *) data + offset;
 
+    auto descriptor = [completion](void const* buffer, size_t size) {
+        return completion ? completion->makeDescriptor(buffer, size)
+                          : backend::BufferDescriptor(buffer, size);
+    };
+
     Mesh* mesh = nullptr;
     char magic[9];
     memcpy(magic, (const char *) p, sizeof(char) * 8);
@@ -484,8 +1230,10 @@ Mesh* decodeMesh(void const* data, off_t offset, MaterialInstance* mi) {
                                               : IndexBuffer::IndexType::UINT)
                 .build(*g_engine);
 
-        mesh->indexBuffer->setBuffer(
-                *g_engine, IndexBuffer::BufferDescriptor(indices, header->indexSize));
+        mesh->indexBuffer->setBuffer(*g_engine, descriptor(indices, header->indexSize));
+        mesh->bufferSize = header->indexSize + header->vertexSize;
+        MemoryTracker::get().track(MemoryTracker::Category::GEOMETRY, mesh->indexBuffer,
+                header->indexSize);
 
         VertexBuffer::Builder vbb;
         vbb.vertexCount(header->vertexCount)
@@ -501,8 +1249,9 @@ Mesh* decodeMesh(void const* data, off_t offset, MaterialInstance* mi) {
                            header->offsetUV0, uint8_t(header->strideUV0))
                 .build(*g_engine);
 
-        VertexBuffer::BufferDescriptor buffer(vertexData, header->vertexSize);
-        mesh->vertexBuffer->setBufferAt(*g_engine, 0, std::move(buffer));
+        mesh->vertexBuffer->setBufferAt(*g_engine, 0, descriptor(vertexData, header->vertexSize));
+        MemoryTracker::get().track(MemoryTracker::Category::GEOMETRY, mesh->vertexBuffer,
+                header->vertexSize);
 
         mesh->renderable = EntityManager::get().create();
 
@@ -529,23 +1278,95 @@ JNIEXPORT void JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_i
         jboolean useSurfaceTexture) {
     LOGD("Started");
 
-    MaterialBuilder::init();
-
-    Package default_material = MaterialBuilder()
-            .name("My material")
-            .material("void material (inout MaterialInputs material) {"
-                      "  prepareMaterial(material);"
-                      "  material.baseColor.rgb = float3(1.0, 0.0, 0.0);"
-                      "}")
-            .shading(MaterialBuilder::Shading::UNLIT)
-            .targetApi(MaterialBuilder::TargetApi::OPENGL)
-            .platform(MaterialBuilder::Platform::MOBILE)
-            .build();
-
-    if (default_material.isValid()) {
+    // Compiled once per process, the package is reused by every following launch
+    Package const* default_material = MaterialRegistry::getPackage("default", []() {
+        MaterialBuilder::init();
+        // declares the parameters driven by updateMaterial() and updateMaterialAlbedo()
+        return MaterialBuilder()
+                .name("My material")
+                .parameter(MaterialBuilder::UniformType::FLOAT3, "albedo")
+                .parameter(MaterialBuilder::UniformType::FLOAT, "metallic")
+                .parameter(MaterialBuilder::UniformType::FLOAT, "roughness")
+                .parameter(MaterialBuilder::UniformType::FLOAT, "clearCoat")
+                .material("void material (inout MaterialInputs material) {"
+                          "  prepareMaterial(material);"
+                          "  material.baseColor.rgb = materialParams.albedo;"
+                          "  material.metallic = materialParams.metallic;"
+                          "  material.roughness = materialParams.roughness;"
+                          "  material.clearCoat = materialParams.clearCoat;"
+                          "}")
+                .shading(MaterialBuilder::Shading::LIT)
+                .targetApi(MaterialBuilder::TargetApi::OPENGL)
+                .platform(MaterialBuilder::Platform::MOBILE)
+                .build();
+    });
+
+    if (default_material) {
         std::cout << "Success!" << std::endl;
     }
 
+    // Samples the maps loaded next to a mesh, see TEXTURE_MAPS
+    Package const* textured_material = MaterialRegistry::getPackage("textured", []() {
+        MaterialBuilder::init();
+        return MaterialBuilder()
+                .name("Textured material")
+                .parameter(MaterialBuilder::SamplerType::SAMPLER_2D, "albedo")
+                .parameter(MaterialBuilder::SamplerType::SAMPLER_2D, "metallic")
+                .parameter(MaterialBuilder::SamplerType::SAMPLER_2D, "roughness")
+                .parameter(MaterialBuilder::SamplerType::SAMPLER_2D, "normal")
+                .parameter(MaterialBuilder::SamplerType::SAMPLER_2D, "ao")
+                // the parameters driven by updateMaterial(), the maps are scaled by the factors
+                .parameter(MaterialBuilder::UniformType::FLOAT, "metallicFactor")
+                .parameter(MaterialBuilder::UniformType::FLOAT, "roughnessFactor")
+                .parameter(MaterialBuilder::UniformType::FLOAT, "clearCoat")
+                .require(VertexAttribute::UV0)
+                // normal maps are RG8, Z is reconstructed from the unit length
+                .material("void material (inout MaterialInputs material) {"
+                          "  float2 uv = getUV0();"
+                          "  float2 n = texture(materialParams_normal, uv).xy * 2.0 - 1.0;"
+                          "  material.normal = float3(n, sqrt(saturate(1.0 - dot(n, n))));"
+                          "  prepareMaterial(material);"
+                          "  material.baseColor = texture(materialParams_albedo, uv);"
+                          "  material.metallic = texture(materialParams_metallic, uv).r"
+                          "          * materialParams.metallicFactor;"
+                          "  material.roughness = texture(materialParams_roughness, uv).r"
+                          "          * materialParams.roughnessFactor;"
+                          "  material.clearCoat = materialParams.clearCoat;"
+                          "  material.ambientOcclusion = texture(materialParams_ao, uv).r;"
+                          "}")
+                .shading(MaterialBuilder::Shading::LIT)
+                .targetApi(MaterialBuilder::TargetApi::OPENGL)
+                .platform(MaterialBuilder::Platform::MOBILE)
+                .build();
+    });
+
+    // Shows the camera feed, sampled from the camera texture of the mesh it's on. A SurfaceTexture
+    // is an external texture, the other paths give plain 2D ones.
+    Package const* camera_material = MaterialRegistry::getPackage(
+            useSurfaceTexture ? "camera_external" : "camera", [useSurfaceTexture]() {
+        MaterialBuilder::init();
+        return MaterialBuilder()
+                .name("Camera material")
+                .parameter(useSurfaceTexture ? MaterialBuilder::SamplerType::SAMPLER_EXTERNAL
+                                             : MaterialBuilder::SamplerType::SAMPLER_2D,
+                           "albedo")
+                .parameter(MaterialBuilder::UniformType::FLOAT, "metallic")
+                .parameter(MaterialBuilder::UniformType::FLOAT, "roughness")
+                .parameter(MaterialBuilder::UniformType::FLOAT, "clearCoat")
+                .require(VertexAttribute::UV0)
+                .material("void material (inout MaterialInputs material) {"
+                          "  prepareMaterial(material);"
+                          "  material.baseColor = texture(materialParams_albedo, getUV0());"
+                          "  material.metallic = materialParams.metallic;"
+                          "  material.roughness = materialParams.roughness;"
+                          "  material.clearCoat = materialParams.clearCoat;"
+                          "}")
+                .shading(MaterialBuilder::Shading::LIT)
+                .targetApi(MaterialBuilder::TargetApi::OPENGL)
+                .platform(MaterialBuilder::Platform::MOBILE)
+                .build();
+    });
+
     STREAM_SAMPLER_TYPE = useSurfaceTexture ? Texture::Sampler::SAMPLER_EXTERNAL
             : Texture::Sampler::SAMPLER_2D;
 
@@ -558,31 +1379,27 @@ JNIEXPORT void JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_i
         #endif
     }
 
+    g_materials = new MaterialRegistry(*g_engine);
+
     // Create a simple colored material
-    g_default_material = Material::Builder()
-        .package(default_material.getData(), default_material.getSize())
-        .build(*g_engine);
+    g_default_material = g_materials->getMaterial(*default_material);
 
-    g_default_mi = g_default_material->createInstance();
-/*    g_default_mi->setParameter("albedo", float3{0.8f});
-    g_default_mi->setParameter("metallic", 1.0f);
-    g_default_mi->setParameter("roughness", 0.7f);
-    g_default_mi->setParameter("clearCoat", 0.0f);*/
+    g_default_mi = g_materials->createInstance(g_default_material);
 
-    g_textured_material = Material::Builder()
-        .package(default_material.getData(), default_material.getSize())
-        .build(*g_engine);
+    g_textured_material = g_materials->getMaterial(*textured_material);
 
-    g_textured_mi = g_textured_material->createInstance();
 
-    g_camera_material = Material::Builder()
-            .package(default_material.getData(), default_material.getSize())
-            .build(*g_engine);
+    g_camera_material = g_materials->getMaterial(*camera_material);
+
+    g_camera_mi = g_materials->createInstance(g_camera_material);
 
-    g_camera_mi = g_camera_material->createInstance();
-/*    g_camera_mi->setParameter("metallic", 1.0f);
-    g_camera_mi->setParameter("roughness", 0.7f);
-    g_camera_mi->setParameter("reflectance", 0.5f);*/
+    g_default_handles = resolveHandles(g_default_material);
+    g_camera_handles = resolveHandles(g_camera_material);
+    g_textured_handles = resolveHandles(g_textured_material);
+    g_material_settings = float3{ 1.0f, 0.7f, 0.0f };
+    setMaterialSettings(g_default_mi, g_default_handles);
+    setMaterialSettings(g_camera_mi, g_camera_handles);
+    g_default_handles.parameters->set(g_default_mi, g_default_handles.albedo, float3{ 0.8f });
 
     auto& em = EntityManager::get();
 
@@ -592,17 +1409,19 @@ JNIEXPORT void JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_i
     u_int32_t width = 1280;
     u_int32_t height = 720;
 
-    // Create a camera looking at the origin
-    g_camera = g_engine->createCamera(em.create());
-
-    // Create a view that takes up the entire window
-    g_view = g_engine->createView();
-    g_view->setName("Main View");
-    g_view->setScene(g_scene);
-    g_view->setCamera(g_camera);
+    // Create a view that takes up the entire window, with a camera looking at the origin
+    g_views = new ViewSet(*g_engine, g_scene);
+    g_view = g_views->getView(0);
+    g_camera = g_views->getCamera(0);
+    g_resolution = new ResolutionController(*g_engine);
+    g_stream_source = new CameraStream(*g_engine);
+    g_uploader = new YuvUploader(*g_engine);
 
     //Models background
     g_renderer = g_engine->createRenderer();
+    g_pacer = new FramePacer(*g_renderer);
+    g_frame_arena = new FrameArena(64 * 1024);
+    g_residency = new ResidencyManager(DEFAULT_GPU_BUDGET, &evictMesh);
     g_renderer->setClearOptions({
                                       .clearColor = {0.25f, 0.5f, 1.0f, 1.0f},
                                       .clear = true
@@ -613,11 +1432,10 @@ JNIEXPORT void JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_i
 
 JNIEXPORT void JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_resize(
         JNIEnv* env, jobject type, jint width, jint height) {
+    g_redraw.invalidate(RedrawTracker::VIEWPORT);
     LOGD("Resizing native window to %d x %d", width, height);
 
-    double ratio = double(width) / height;
-    g_camera->setProjection(65.0, ratio, 0.1, 10.0, Camera::Fov::VERTICAL);
-    g_view->setViewport({ 0, 0, uint32_t(width), uint32_t(height) });
+    g_views->resize(uint32_t(width), uint32_t(height));
 
     if (g_swapChain) {
         // TODO: should this be done by the engine, so it's synchronous with viewport updates?
@@ -627,6 +1445,104 @@ JNIEXPORT void JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_r
     }
 }
 
+JNIEXPORT jint JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_addView(
+        JNIEnv* env, jobject type, jstring name_, jfloat left, jfloat bottom, jfloat width,
+        jfloat height, jboolean postProcessing) {
+    g_redraw.invalidate(RedrawTracker::VIEWPORT);
+    const char* name = env->GetStringUTFChars(name_, 0);
+    size_t const index = g_views->add(name, { left, bottom, width, height }, postProcessing);
+    env->ReleaseStringUTFChars(name_, name);
+    return jint(index);
+}
+
+JNIEXPORT void JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_removeView(
+        JNIEnv* env, jobject type, jint index) {
+    g_redraw.invalidate(RedrawTracker::VIEWPORT);
+    g_views->remove(size_t(index));
+}
+
+JNIEXPORT void JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setViewRect(
+        JNIEnv* env, jobject type, jint index, jfloat left, jfloat bottom, jfloat width,
+        jfloat height) {
+    g_redraw.invalidate(RedrawTracker::VIEWPORT);
+    if (index >= 0 && size_t(index) < g_views->getCount()) {
+        g_views->setRect(size_t(index), { left, bottom, width, height });
+    }
+}
+
+JNIEXPORT void JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setViewCamera(
+        JNIEnv* env, jobject type, jint index, jfloat eyeX, jfloat eyeY, jfloat eyeZ,
+        jfloat centerX, jfloat centerY, jfloat centerZ) {
+    g_redraw.invalidate(RedrawTracker::CAMERA);
+    if (index >= 0 && size_t(index) < g_views->getCount()) {
+        g_views->getCamera(size_t(index))->lookAt(
+                { eyeX, eyeY, eyeZ }, { centerX, centerY, centerZ }, { 0, 1, 0 });
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setDynamicResolution(JNIEnv* env,
+        jclass type, jboolean enabled, jfloat targetFrameRate, jfloat minScale, jfloat maxScale) {
+    g_redraw.invalidate(RedrawTracker::VIEWPORT);
+    ResolutionController::Options options = g_resolution->getOptions();
+    options.enabled = enabled;
+    options.targetFrameTimeMs = 1000.0f / std::max(targetFrameRate, 1.0f);
+    options.minScale = minScale;
+    options.maxScale = maxScale;
+    g_resolution->setOptions(options);
+}
+
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_getDynamicResolutionState(JNIEnv* env,
+        jclass type, jfloatArray out_) {
+    ResolutionController::State const& state = g_resolution->getState();
+    jfloat const values[] = {
+            state.scale, state.cpuFrameTimeMs, state.gpuFrameTimeMs, state.errorMs };
+    if (env->GetArrayLength(out_) >= jsize(std::size(values))) {
+        env->SetFloatArrayRegion(out_, 0, jsize(std::size(values)), values);
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setOnDemandRendering(JNIEnv* env,
+        jclass type, jboolean enabled) {
+    g_redraw.setOnDemand(enabled);
+}
+
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_requestRedraw(JNIEnv* env, jclass type) {
+    g_redraw.invalidate(RedrawTracker::REQUESTED);
+}
+
+JNIEXPORT jint JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_getSkippedFrames(JNIEnv* env,
+        jclass type) {
+    return jint(g_redraw.resetStats().skipped);
+}
+
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setDisplayInfo(JNIEnv* env, jclass type,
+        jfloat refreshRate, jlong presentationDeadlineNanos, jlong vsyncOffsetNanos) {
+    g_pacer->setDisplayInfo(refreshRate, uint64_t(presentationDeadlineNanos),
+            uint64_t(vsyncOffsetNanos));
+}
+
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setMaxFrameInterval(JNIEnv* env,
+        jclass type, jint interval) {
+    g_pacer->setMaxInterval(uint8_t(std::clamp(interval, 1, 255)));
+}
+
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_getFrameStats(JNIEnv* env, jclass type,
+        jintArray out_) {
+    FramePacer::Stats const stats = g_pacer->resetStats();
+    jint const values[] = { jint(stats.frames), jint(stats.janks), jint(stats.interval) };
+    if (env->GetArrayLength(out_) >= jsize(std::size(values))) {
+        env->SetIntArrayRegion(out_, 0, jsize(std::size(values)), values);
+    }
+}
+
 JNIEXPORT void JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_destroy(
         JNIEnv* env, jobject type) {
     LOGD(">>> Destroy");
@@ -634,17 +1550,26 @@ JNIEXPORT void JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_d
     delete g_ibl;
 
     destroyMeshes();
+    delete g_residency;
+    g_residency = nullptr;
 
-    g_engine->destroy(g_default_mi);
-    g_engine->destroy(g_default_material);
-    g_engine->destroy(g_textured_mi);
-    g_engine->destroy(g_textured_material);
-    g_engine->destroy(g_camera_mi);
-    g_engine->destroy(g_camera_material);
-    g_engine->destroy(g_camera);
+    // pending uploads may still read from the bundle
+    if (!g_loads.empty()) {
+        Fence::waitAndDestroy(g_engine->createFence());
+        retireLoads(true);
+    }
+    delete g_bundle;
+    g_bundle = nullptr;
+
+    // Destroys the material instances along with their materials
+    delete g_materials;
+    delete g_views;
+    delete g_resolution;
     g_engine->destroy(g_scene);
-    g_engine->destroy(g_view);
-    g_engine->destroy(g_camera_stream);
+    delete g_stream_source;
+    // waits for the engine to give back the frames it's uploading
+    delete g_uploader;
+    JniImageCallback::flush(env);
 
     g_engine->destroy(g_light);
     g_engine->destroy(g_light1);
@@ -652,19 +1577,31 @@ JNIEXPORT void JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_d
     g_engine->destroy(g_light3);
     g_engine->destroy(g_light4);
 
+    delete g_pacer;
+    delete g_frame_arena;
     g_engine->destroy(g_renderer);
 
 
     g_default_mi = nullptr;
     g_default_material = nullptr;
-    g_textured_mi = nullptr;
     g_textured_material = nullptr;
     g_camera_mi = nullptr;
     g_camera_material = nullptr;
     g_camera = nullptr;
     g_scene = nullptr;
+    g_views = nullptr;
     g_view = nullptr;
+    g_resolution = nullptr;
     g_camera_stream = nullptr;
+    g_stream_source = nullptr;
+    g_uploader = nullptr;
+    g_camera_frames = false;
+    g_materials = nullptr;
+    g_default_handles = {};
+    g_camera_handles = {};
+    g_textured_handles = {};
+    g_commands = CommandRing();
+    g_redraw = RedrawTracker();
 
     g_ibl = nullptr;
 
@@ -672,6 +1609,11 @@ JNIEXPORT void JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_d
     em.destroy(g_light);
 
     g_renderer = nullptr;
+    g_pacer = nullptr;
+    g_frame_arena = nullptr;
+
+    // Gives back the upload buffers the engine is done with, the others stay until released
+    PixelBufferPool::get().trim();
 
     // We could destroy the engine, but we don't have to, it'll be reused next time
     // In fact we don't have to destroy any of the objects here (useful during screen rotation)
@@ -682,6 +1624,7 @@ JNIEXPORT void JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_d
 JNIEXPORT void JNICALL
 Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setSwapChain(JNIEnv *env, jclass type,
                                                                    jobject nativeWindow) {
+    g_redraw.invalidate(RedrawTracker::VIEWPORT);
     if (g_swapChain) {
         g_engine->destroy(g_swapChain);
         g_swapChain = nullptr;
@@ -691,10 +1634,26 @@ Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setSwapChain(JNIEnv *env
 }
 
 JNIEXPORT void JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_render(
-        JNIEnv *env, jclass type, jboolean objectRotation, jboolean cameraRotation) {
+        JNIEnv *env, jclass type, jboolean objectRotation, jboolean cameraRotation,
+        jlong frameTimeNanos) {
+    g_resolution->beginFrame();
+
+    // Apply everything Java queued since the last frame
+    drainCommands(*g_frame_arena);
+
+    // Meshes on screen are never evicted, the others go least recently shown first
+    for (Mesh* mesh : g_meshes) {
+        g_residency->touch(mesh, getMeshSize(mesh));
+    }
+    g_residency->endFrame();
 
     if (!currentModel)
     {
+        // nothing to draw, but loads still complete and Java still wants its buffers back
+        retireLoads(false);
+        JniBufferCallback::flush(env);
+        JniImageCallback::flush(env);
+        g_frame_arena->endFrame();
         return;
     } else {
         auto &tcm = g_engine->getTransformManager();
@@ -712,10 +1671,12 @@ JNIEXPORT void JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_r
         if (objectRotation) {
             auto& tcm = g_engine->getTransformManager();
             tcm.setTransform(tcm.getInstance(currentModel), r);
+            g_redraw.invalidate(RedrawTracker::TRANSFORM);
         }
         if (cameraRotation) {
             auto c = mat4f::translation(float3{0, 0, 4});
             g_view->getCamera().setModelMatrix(r * c);
+            g_redraw.invalidate(RedrawTracker::CAMERA);
         }
     }
 
@@ -724,131 +1685,324 @@ JNIEXPORT void JNICALL Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_r
         tcm.setTransform(tcm.getInstance(g_meshes[0]->renderable), mat4f::translation(float3{0, 0, -4}));
     }*/
 
-    if (g_renderer->beginFrame(g_swapChain)) {
-        g_renderer->render(g_view);
-        g_renderer->endFrame();
+    g_material_stats = g_materials->resetStats();
+    if (g_material_stats.updates) {
+        g_redraw.invalidate(RedrawTracker::MATERIAL);
+    }
+    if (retireLoads(false)) {
+        g_redraw.invalidate(RedrawTracker::CONTENT);
+    }
+    // frames of an external stream arrive on their own
+    g_redraw.setContinuous(g_camera_stream != nullptr);
+
+    bool rendered = false;
+    bool const due = g_pacer->beginFrame(uint64_t(frameTimeNanos));
+    if (due && g_camera_frames && !g_meshes.empty() &&
+            g_uploader->upload(&g_meshes[0]->camera, g_camera_mi, "albedo")) {
+        // a converted camera frame is on its way to the stream texture
+        g_redraw.invalidate(RedrawTracker::CONTENT);
+    }
+    if (due && finishMapLoads()) {
+        // meshes are shown with their maps, from previews
+        g_redraw.invalidate(RedrawTracker::CONTENT);
+    }
+    if (due && uploadPendingMaps()) {
+        // maps of meshes are now at full resolution
+        g_redraw.invalidate(RedrawTracker::CONTENT);
+        if (g_pending_maps.empty() && g_map_loads.empty()) {
+            // the decoded maps are gone, only the slabs of the uploads in flight are kept
+            PixelBufferPool::get().trim();
+        }
+    }
+    if (!due) {
+        // within the current frame interval
+    } else if (!g_redraw.shouldRender()) {
+        g_redraw.frameSkipped();
+    } else {
+        // the most recent camera image goes into this frame
+        g_stream_source->latch(int64_t(frameTimeNanos));
+        if (g_renderer->beginFrame(g_swapChain, uint64_t(frameTimeNanos))) {
+            g_views->render(*g_renderer);
+            g_renderer->endFrame();
+            g_redraw.frameRendered();
+            rendered = true;
+        }
+    }
+
+    // The new scale takes effect next frame
+    float const scale = g_resolution->getState().scale;
+    g_resolution->endFrame(rendered);
+    if (rendered) {
+        ResolutionController::State const& state = g_resolution->getState();
+        g_pacer->endFrame(std::max(state.cpuFrameTimeMs, state.gpuFrameTimeMs));
     }
+    if (g_resolution->getState().scale != scale) {
+        g_redraw.invalidate(RedrawTracker::VIEWPORT);
+    }
+    for (size_t i = 0; i < g_views->getCount(); i++) {
+        g_resolution->apply(*g_views->getView(i));
+    }
+
+    // Buffers released by the engine since the last frame are handed back to Java together
+    JniBufferCallback::flush(env);
+    JniImageCallback::flush(env);
+
+    g_frame_arena->endFrame();
 }
 
 JNIEXPORT void JNICALL
 Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_finish(JNIEnv *env, jclass type) {
     if (g_engine) { // engine may have been destroyed already
+        // The surface is going away, this one has to wait for the GPU
         Fence::waitAndDestroy(g_engine->createFence());
+        retireLoads(false);
+        JniBufferCallback::flush(env);
+        JniImageCallback::flush(env);
     }
 }
 
 JNIEXPORT void JNICALL
 Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_updateMaterial(JNIEnv *env, jclass type,
         jfloat metallic, jfloat roughness, jfloat clearCoat) {
-
-    MaterialInstance *mi = g_camera_stream ? g_camera_mi : g_default_mi;
-    mi->setParameter("metallic", metallic);
-    mi->setParameter("roughness", roughness);
-    mi->setParameter("clearCoat", clearCoat);
+    updateMaterial(metallic, roughness, clearCoat);
 }
 
 JNIEXPORT void JNICALL
 Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_updateMaterialAlbedo(JNIEnv *env, jclass type,
         jfloat r, jfloat g, jfloat b) {
+    updateMaterialAlbedo(r, g, b);
+}
 
-    MaterialInstance *mi = g_default_mi;
-    mi->setParameter("albedo", Color::toLinear<ACCURATE>(sRGBColor{r, g, b}));
+JNIEXPORT jint JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_getSkippedMaterialUpdates(JNIEnv *env,
+        jclass type) {
+    return (jint) g_material_stats.skipped;
+}
+
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setCommandRing(JNIEnv *env, jclass type,
+        jobject buffer) {
+    g_commands = CommandRing();
+    if (buffer) {
+        g_commands = CommandRing(env->GetDirectBufferAddress(buffer),
+                (size_t) env->GetDirectBufferCapacity(buffer));
+        if (!g_commands.isValid()) {
+            LOGD("Command ring ignored: expected a direct buffer with a power-of-two storage");
+        }
+    }
 }
 
 JNIEXPORT void JNICALL
 Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setCameraStream(
         JNIEnv *env, jclass type, jobject st) {
+    g_redraw.invalidate(RedrawTracker::CONTENT);
+    bindCameraStream(st ? g_stream_source->createNative(st) : nullptr);
+}
 
-    if (g_camera_stream) {
-        g_engine->destroy(g_camera_stream);
-        g_camera_stream = nullptr;
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setCameraStreamWithTexture(JNIEnv *env, jclass type,
+        jlong cameraTexture, jint width, jint height) {
+    g_redraw.invalidate(RedrawTracker::CONTENT);
+    bindCameraStream(cameraTexture ? g_stream_source->createTextureId(
+            intptr_t(cameraTexture), uint32_t(width), uint32_t(height)) : nullptr);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setCameraStreamAcquired(JNIEnv *env,
+        jclass type, jboolean enabled, jint width, jint height) {
+    if (enabled && !getFromHardwareBuffer()) {
+        // no image could ever be pushed to the stream
+        LOGD("WARNING: acquired camera streams require API 26");
+        return JNI_FALSE;
     }
+    g_redraw.invalidate(RedrawTracker::CONTENT);
+    bindCameraStream(enabled ? g_stream_source->createAcquired(uint32_t(width), uint32_t(height))
+                             : nullptr);
+    return JNI_TRUE;
+}
 
-    if (st) {
-        g_camera_stream = Stream::Builder()
-                .stream(st)
-                .build(*g_engine);
-        g_meshes[0]->textures[0]->setExternalStream(*g_engine, g_camera_stream);
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_pushCameraImage(JNIEnv *env,
+        jclass type, jobject hardwareBuffer, jlong timestampNanos, jobject handler,
+        jobject callback) {
+    FromHardwareBuffer const fromHardwareBuffer = getFromHardwareBuffer();
+    if (!fromHardwareBuffer) {
+        LOGD("WARNING: acquired camera streams require API 26");
+        // the image can be closed right away
+        JniImageCallback::invoke(nullptr,
+                JniImageCallback::make(g_engine, env, handler, callback, 0));
+        return;
     }
+    AHardwareBuffer* buffer = fromHardwareBuffer(env, hardwareBuffer);
+    // callback runs once the engine (or the stream, if the image is dropped) is done with it,
+    // the image must stay open until then. Either happens on a thread env isn't valid on, so
+    // the release is only posted and the next flush calls into Java.
+    JniImageCallback* release = JniImageCallback::make(g_engine, env, handler, callback,
+            (long) buffer);
+    g_stream_source->pushImage(buffer, int64_t(timestampNanos), &JniImageCallback::post, release);
+}
 
-    auto& rcm = g_engine->getRenderableManager();
-    rcm.setMaterialInstanceAt(
-            rcm.getInstance(g_meshes[0]->renderable), 0, st ? g_camera_mi : g_default_mi);
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setCameraImageMaxAge(JNIEnv *env,
+        jclass type, jlong maxAgeNanos) {
+    g_stream_source->setMaxAge(int64_t(maxAgeNanos));
 }
 
-};
-extern "C" JNIEXPORT void JNICALL
-Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setCameraStreamWithTexture(JNIEnv *env, jclass type,
-        jlong cameraTexture, jint width, jint height) {
-    if (g_camera_stream) {
-        g_engine->destroy(g_camera_stream);
-        g_camera_stream = nullptr;
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_getCameraStreamStats(JNIEnv *env,
+        jclass type, jfloatArray out_) {
+    CameraStream::Stats const stats = g_stream_source->resetStats();
+    jfloat const values[] = { jfloat(stats.frames), jfloat(stats.dropped), jfloat(stats.stale),
+            stats.averageLatencyMs, stats.maxLatencyMs };
+    if (env->GetArrayLength(out_) >= jsize(std::size(values))) {
+        env->SetFloatArrayRegion(out_, 0, jsize(std::size(values)), values);
     }
+}
 
-    if (cameraTexture) {
-        g_camera_stream = Stream::Builder()
-                .stream(cameraTexture)
-                .width((uint32_t) width)
-                .height((uint32_t) height)
-                .build(*g_engine);
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_getMemoryUsage(JNIEnv *env,
+        jclass type, jlongArray out_) {
+    MemoryTracker const& tracker = MemoryTracker::get();
+    jlong values[(MemoryTracker::CATEGORY_COUNT + 1) * 3];
+    for (size_t i = 0; i <= MemoryTracker::CATEGORY_COUNT; i++) {
+        MemoryTracker::Usage const usage = i < MemoryTracker::CATEGORY_COUNT
+                ? tracker.getUsage(MemoryTracker::Category(i)) : tracker.getTotal();
+        values[i * 3 + 0] = jlong(usage.live);
+        values[i * 3 + 1] = jlong(usage.peak);
+        values[i * 3 + 2] = jlong(usage.count);
+    }
+    if (env->GetArrayLength(out_) >= jsize(std::size(values))) {
+        env->SetLongArrayRegion(out_, 0, jsize(std::size(values)), values);
+    }
+}
 
-        g_meshes[0]->textures[0]->setExternalStream(*g_engine, g_camera_stream);
+JNIEXPORT jstring JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_dumpMemoryUsage(JNIEnv *env,
+        jclass type) {
+    return env->NewStringUTF(MemoryTracker::get().toJson().c_str());
+}
+
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setGpuBudget(JNIEnv *env,
+        jclass type, jlong bytes) {
+    g_residency->setBudget(size_t(std::max(bytes, jlong(0))));
+}
+
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_getResidencyStats(JNIEnv *env,
+        jclass type, jlongArray out_) {
+    ResidencyManager::Stats const stats = g_residency->getStats();
+    jlong const values[] = { jlong(stats.budget), jlong(stats.resident), jlong(stats.count),
+            jlong(stats.evictions) };
+    if (env->GetArrayLength(out_) >= jsize(std::size(values))) {
+        env->SetLongArrayRegion(out_, 0, jsize(std::size(values)), values);
     }
+}
 
-    auto& rcm = g_engine->getRenderableManager();
-    rcm.setMaterialInstanceAt(
-            rcm.getInstance(g_meshes[0]->renderable), 0, cameraTexture ? g_camera_mi : g_default_mi);}
-extern "C"
 JNIEXPORT void JNICALL
-Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_updateTransform(JNIEnv *env, jclass clazz) {
-    /* Kotlin Base Code
-        val tm = engine.transformManager
-        var center = asset.boundingBox.center.let { v-> Float3(v[0], v[1], v[2]) }
-        val halfExtent = asset.boundingBox.halfExtent.let { v-> Float3(v[0], v[1], v[2]) }
-        val maxExtent = 2.0f * max(halfExtent)
-        val scaleFactor = 2.0f / maxExtent
-        center -= centerPoint / scaleFactor
-        val transform = scale(Float3(scaleFactor)) * translation(-center)
-        tm.setTransform(tm.getInstance(asset.root), transpose(transform).toFloatArray())
-     */
-    if(filamentAsset){
-        TransformManager* tm = &g_engine->getTransformManager();
-        auto boundingBoxCenter = filamentAsset->getBoundingBox().center();
-        auto center = float3{boundingBoxCenter[0],boundingBoxCenter[1],boundingBoxCenter[2]};
-        auto halfExtent = filamentAsset->getBoundingBox().extent(); // Todo: max of it
-        float max = 0.0;
-        //max of halfExtent
-        if(halfExtent[0] > halfExtent[1] && halfExtent[0] > halfExtent[2]){
-            max = halfExtent[0];
-        }
-        if(halfExtent[1] > halfExtent[0] && halfExtent[1] > halfExtent[2]){
-            max = halfExtent[1];
-        }
-        if(halfExtent[2] > halfExtent[0] && halfExtent[2] > halfExtent[1]){
-            max = halfExtent[2];
-        }
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_getFrameArenaStats(JNIEnv *env,
+        jclass type, jlongArray out_) {
+    FrameArena::Stats const stats = g_frame_arena->getStats();
+    jlong const values[] = { jlong(stats.capacity), jlong(stats.used), jlong(stats.highWatermark),
+            jlong(stats.overflows) };
+    if (env->GetArrayLength(out_) >= jsize(std::size(values))) {
+        env->SetLongArrayRegion(out_, 0, jsize(std::size(values)), values);
+    }
+}
 
-        float maxExtent = 2.0f * max;
-        float scaleFactor = 2.0f / maxExtent;
-        float3 centerPoint = float3{0,0,-4};//defaults to < 0, 0, -4 >
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_getPixelBufferPoolStats(JNIEnv *env,
+        jclass type, jlongArray out_) {
+    PixelBufferPool::Stats const stats = PixelBufferPool::get().getStats();
+    jlong const values[] = { jlong(stats.reserved), jlong(stats.used), jlong(stats.slabs),
+            jlong(stats.heapAllocations) };
+    if (env->GetArrayLength(out_) >= jsize(std::size(values))) {
+        env->SetLongArrayRegion(out_, 0, jsize(std::size(values)), values);
+    }
+}
 
-        center -= (centerPoint / scaleFactor);
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setTextureBudget(JNIEnv *env,
+        jclass type, jlong bytes) {
+    g_texture_downscaler.setBudget(size_t(std::max(bytes, jlong(0))));
+}
 
-        auto scaleAsFloat3 = float3{scaleFactor, scaleFactor, scaleFactor};
-        //mat4f boundingBoxCenterAsMat4 = mat4f{float4{-center,1}};
-        auto scaling = mat4f::scaling(scaleAsFloat3);
-        auto translation = mat4f::translation(-center);
-        auto transform = scaling * translation;
-        auto transposeMat = transpose(transform);
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setTextureFilter(JNIEnv *env,
+        jclass type, jint filter) {
+    if (filter >= jint(image::Filter::DEFAULT) && filter <= jint(image::Filter::MINIMUM)) {
+        g_texture_downscaler.setFilter(image::Filter(filter));
+    }
+}
 
-        tm->setTransform(tm->getInstance(filamentAsset->getRoot()), transposeMat);
-        auto checkTransform = tm->getTransform(tm->getInstance(filamentAsset->getRoot()));
-        auto asFloatArray = checkTransform.asArray();
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setTextureCompression(JNIEnv *env,
+        jclass type, jint quality) {
+    // 0 disables compression, 1 and 2 are the FAST and HIGH presets
+    g_compress_textures = quality > 0;
+    g_etc2_encoder.setQuality(quality > 1 ? Etc2Encoder::Quality::HIGH
+                                          : Etc2Encoder::Quality::FAST);
+}
 
-        auto camPos = g_camera->getPosition();
-        auto camProjMat = g_camera->getProjectionMatrix();
-        camPos;
-        camProjMat;
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_getTextureDownscaleStats(JNIEnv *env,
+        jclass type, jlongArray out_) {
+    TextureDownscaler::Stats const& stats = g_texture_downscaler.getStats();
+    jlong const values[] = { jlong(stats.images), jlong(stats.downscaled),
+            jlong(stats.decodedBytes), jlong(stats.keptBytes) };
+    if (env->GetArrayLength(out_) >= jsize(std::size(values))) {
+        env->SetLongArrayRegion(out_, 0, jsize(std::size(values)), values);
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_setCameraFrameUpload(JNIEnv *env,
+        jclass type, jboolean enabled) {
+    if (enabled && STREAM_SAMPLER_TYPE != Texture::Sampler::SAMPLER_2D) {
+        LOGD("WARNING: camera frames can only be uploaded without a SurfaceTexture");
+        return;
+    }
+    g_redraw.invalidate(RedrawTracker::CONTENT);
+    bindCameraFrames(enabled);
+}
 
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_pushCameraFrame(JNIEnv *env,
+        jclass type, jobject y, jobject u, jobject v, jint yRowStride, jint uvRowStride,
+        jint uvPixelStride, jint width, jint height, jobject handler, jobject callback) {
+    YuvUploader::Planes planes;
+    planes.y = (uint8_t const*) env->GetDirectBufferAddress(y);
+    planes.u = (uint8_t const*) env->GetDirectBufferAddress(u);
+    planes.v = (uint8_t const*) env->GetDirectBufferAddress(v);
+    planes.yRowStride = uint32_t(yRowStride);
+    planes.uvRowStride = uint32_t(uvRowStride);
+    planes.uvPixelStride = uint32_t(uvPixelStride);
+    planes.width = uint32_t(width);
+    planes.height = uint32_t(height);
+    if (!planes.y || !planes.u || !planes.v || width <= 0 || height <= 0) {
+        LOGD("Camera frame ignored: expected the direct buffers of a YUV_420_888 image");
+        return;
     }
-}
\ No newline at end of file
+    // callback runs on the frame following the conversion of the planes (or the drop of the
+    // frame), the image must stay open until then
+    JniImageCallback* release = JniImageCallback::make(g_engine, env, handler, callback, 0);
+    g_uploader->push(planes, &JniImageCallback::post, release);
+}
+
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_getCameraUploadStats(JNIEnv *env,
+        jclass type, jfloatArray out_) {
+    YuvUploader::Stats const stats = g_uploader->resetStats();
+    jfloat const values[] = { jfloat(stats.frames), jfloat(stats.dropped),
+            stats.averageConvertMs, stats.maxConvertMs };
+    if (env->GetArrayLength(out_) >= jsize(std::size(values))) {
+        env->SetFloatArrayRegion(out_, 0, jsize(std::size(values)), values);
+    }
+}
+
+};
+extern "C"
+JNIEXPORT void JNICALL
+Java_ru_arvrlab_hardcoreFilament_filament_HelloFilament_updateTransform(JNIEnv *env, jclass clazz) {
+    updateTransform();
+}
@@ -0,0 +1,86 @@
+package ru.arvrlab.hardcoreFilament.filament
+
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * Commands queued here are executed by [HelloFilament.render] at the start of the next frame,
+ * instead of crossing JNI once per update. The layout must match CommandRing.h.
+ *
+ * Not thread-safe: the indices are plain ByteBuffer reads and writes, so commands must be written
+ * on the thread calling [HelloFilament.render], whose JNI call hands the writes to native code.
+ * It batches updates between frames, it is not a queue between threads.
+ */
+class CommandRing(private val capacity: Int = DEFAULT_CAPACITY) {
+    val buffer: ByteBuffer
+    private var head = 0
+
+    init {
+        require(capacity >= 16 && capacity and (capacity - 1) == 0) {
+            "capacity must be a power of two"
+        }
+        buffer = ByteBuffer.allocateDirect(DATA_OFFSET + capacity).order(ByteOrder.nativeOrder())
+    }
+
+    /** @return false if the ring is full and the command was dropped */
+    fun updateMaterial(metallic: Float, roughness: Float, clearCoat: Float): Boolean {
+        val offset = begin(UPDATE_MATERIAL, 3)
+        if (offset < 0) return false
+        buffer.putFloat(offset, metallic)
+        buffer.putFloat(offset + 4, roughness)
+        buffer.putFloat(offset + 8, clearCoat)
+        publish(3)
+        return true
+    }
+
+    fun updateMaterialAlbedo(r: Float, g: Float, b: Float): Boolean {
+        val offset = begin(UPDATE_MATERIAL_ALBEDO, 3)
+        if (offset < 0) return false
+        buffer.putFloat(offset, r)
+        buffer.putFloat(offset + 4, g)
+        buffer.putFloat(offset + 8, b)
+        publish(3)
+        return true
+    }
+
+    fun updateTransform(): Boolean {
+        if (begin(UPDATE_TRANSFORM, 0) < 0) return false
+        publish(0)
+        return true
+    }
+
+    // Writes the command header, returns the buffer offset of its payload or -1 if it doesn't fit
+    private fun begin(command: Int, wordCount: Int): Int {
+        val size = (1 + wordCount) * 4
+        val tail = buffer.getInt(TAIL_OFFSET)
+        var index = head and (capacity - 1)
+        // commands never wrap, the end of the storage is skipped with a padding command
+        val padding = if (size > capacity - index) capacity - index else 0
+        if (head - tail + padding + size > capacity) return -1
+        if (padding > 0) {
+            buffer.putInt(DATA_OFFSET + index, (PADDING shl 16) or (padding / 4 - 1))
+            head += padding
+            index = 0
+        }
+        buffer.putInt(DATA_OFFSET + index, (command shl 16) or wordCount)
+        return DATA_OFFSET + index + 4
+    }
+
+    private fun publish(wordCount: Int) {
+        head += (1 + wordCount) * 4
+        buffer.putInt(HEAD_OFFSET, head)
+    }
+
+    companion object {
+        const val DEFAULT_CAPACITY = 4096
+
+        private const val HEAD_OFFSET = 0
+        private const val TAIL_OFFSET = 64
+        private const val DATA_OFFSET = 128
+
+        private const val PADDING = 0
+        private const val UPDATE_MATERIAL = 1
+        private const val UPDATE_MATERIAL_ALBEDO = 2
+        private const val UPDATE_TRANSFORM = 3
+    }
+}
@@ -12,22 +12,117 @@ object HelloFilament {
 
     external fun init(msaaSampleCount: Int, sharedContext: Long, useSurfaceTexture: Boolean)
 
+    // Assets found in the bundle are read from it instead of being opened one by one
+    external fun loadAssetBundle(assets: AssetManager?, name: String?): Boolean
+
     external fun loadIbl(assets: AssetManager?, name: String?)
-    external fun loadMesh(assets: AssetManager?, name: String?)
+    // Returns without waiting for the upload, poll the returned id with isLoadComplete()
+    external fun loadMesh(assets: AssetManager?, name: String?): Int
+    external fun isLoadComplete(id: Int): Boolean
     external fun loadGlbModel(assets: AssetManager?, name: String?)
     external fun loadGlbModelWith(buffer: ByteBuffer?, remaining: Int)
     external fun resize(width: Int, height: Int)
+
+    // Views share the scene and are drawn in order over the main view (index 0). Rects are
+    // fractions of the window, from its bottom-left corner.
+    external fun addView(name: String, left: Float, bottom: Float, width: Float, height: Float,
+                         postProcessing: Boolean): Int
+    external fun removeView(index: Int)
+    external fun setViewRect(index: Int, left: Float, bottom: Float, width: Float, height: Float)
+    external fun setViewCamera(index: Int, eyeX: Float, eyeY: Float, eyeZ: Float,
+                               centerX: Float, centerY: Float, centerZ: Float)
+    // Scales the views' resolution to hold targetFrameRate, within [minScale, maxScale]
+    external fun setDynamicResolution(enabled: Boolean, targetFrameRate: Float,
+                                      minScale: Float, maxScale: Float)
+
+    // Fills out with: scale, CPU frame time (ms), GPU frame time (ms, 0 while it keeps up) and
+    // the frame time error (ms, positive when over the target)
+    external fun getDynamicResolutionState(out: FloatArray)
+
     external fun destroy()
-    external fun render(objectRotation: Boolean, cameraRotation: Boolean)
+    // frameTimeNanos is the vsync time given to Choreographer.FrameCallback.doFrame()
+    external fun render(objectRotation: Boolean, cameraRotation: Boolean, frameTimeNanos: Long)
+
+    // Properties of the display the frames are paced against, see android.view.Display
+    external fun setDisplayInfo(refreshRate: Float, presentationDeadlineNanos: Long,
+                                vsyncOffsetNanos: Long)
+    // Longest frame interval, in refresh periods, the pacing may fall back to
+    external fun setMaxFrameInterval(interval: Int)
+    // Fills out with: frames drawn and janky frames since the last call, current interval
+    external fun getFrameStats(out: IntArray)
+
+    // When enabled, render() only draws frames after something on screen changed
+    external fun setOnDemandRendering(enabled: Boolean)
+    external fun requestRedraw()
+    // Number of frames skipped since the last call
+    external fun getSkippedFrames(): Int
 
     external fun updateTransform()
     external fun updateMaterial(metallic: Float, roughness: Float, reflectance: Float)
 
     external fun updateMaterialAlbedo(r: Float, g: Float, b: Float)
 
+    // Number of material parameter updates skipped during the last frame as they changed nothing
+    external fun getSkippedMaterialUpdates(): Int
+
+    // Commands written to the ring are executed at the start of the next render()
+    external fun setCommandRing(buffer: ByteBuffer?)
+
     external fun setSwapChain(nativeWindow: Surface?)
     external fun setCameraStream(st: SurfaceTexture?)
     external fun setCameraStreamWithTexture(cameraTexture: Long, width: Int, height: Int)
 
+    // Low latency path (API 26+): camera images are pushed as HardwareBuffers with
+    // pushCameraImage() and the most recent one is shown by the next frame. Returns false,
+    // leaving the current stream as it is, if the device doesn't support it.
+    external fun setCameraStreamAcquired(enabled: Boolean, width: Int, height: Int): Boolean
+    // timestampNanos must come from System.nanoTime()'s clock, callback is posted on handler
+    // once the image can be closed
+    external fun pushCameraImage(hardwareBuffer: Any, timestampNanos: Long, handler: Any?,
+                                 callback: Runnable)
+    // Images older than this when their frame starts are dropped, 0 keeps them all
+    external fun setCameraImageMaxAge(maxAgeNanos: Long)
+    // Fills out with: frames shown, dropped and stale images since the last call, average and
+    // max latency (ms) from image timestamp to frame vsync
+    external fun getCameraStreamStats(out: FloatArray)
+
+    // Fills out with live bytes, peak bytes and live allocation count of each memory category:
+    // geometry, textures, environment, materials, staging, assets, then of their total
+    external fun getMemoryUsage(out: LongArray)
+    // The same as a JSON object, keyed by category name
+    external fun dumpMemoryUsage(): String
+    // Bytes of meshes kept on the GPU, the least recently shown ones are destroyed beyond that
+    external fun setGpuBudget(bytes: Long)
+    // Fills out with: GPU budget and estimated resident bytes, resident mesh count, and the
+    // number of meshes evicted so far
+    external fun getResidencyStats(out: LongArray)
+    // Bytes of texture maps loaded with a mesh, larger maps are downscaled, least important first
+    external fun setTextureBudget(bytes: Long)
+    // Filter used to downscale texture maps, the ordinal of image::Filter (0 for the default)
+    external fun setTextureFilter(filter: Int)
+    // Compression of the RGBA maps loaded with a mesh: 0 for none, 1 for fast ETC2 encoding
+    // (the default) and 2 for higher quality at about 7 times the encoding time
+    external fun setTextureCompression(quality: Int)
+    // Fills out with: maps decoded, maps downscaled, bytes at full resolution and bytes kept
+    external fun getTextureDownscaleStats(out: LongArray)
+    // Fills out with: capacity of each of the render loop's scratch arenas, bytes used by the
+    // last frame, high watermark in bytes, and the number of allocations that didn't fit
+    external fun getFrameArenaStats(out: LongArray)
+    // Fills out with: bytes reserved and used by the upload buffer pool, its slab count, and the
+    // number of heap allocations it made so far (steady once uploads are warmed up)
+    external fun getPixelBufferPoolStats(out: LongArray)
+
+    // CPU path, when init() was called without useSurfaceTexture: YUV_420_888 images pushed
+    // with pushCameraFrame() are converted to RGBA off the render thread and uploaded
+    external fun setCameraFrameUpload(enabled: Boolean)
+    // Takes the planes of an ImageReader image, callback is posted on handler once the image
+    // can be closed
+    external fun pushCameraFrame(y: ByteBuffer, u: ByteBuffer, v: ByteBuffer, yRowStride: Int,
+                                 uvRowStride: Int, uvPixelStride: Int, width: Int, height: Int,
+                                 handler: Any?, callback: Runnable)
+    // Fills out with: frames uploaded and dropped since the last call, average and max
+    // conversion time (ms)
+    external fun getCameraUploadStats(out: FloatArray)
+
     external fun finish()
 }
\ No newline at end of file
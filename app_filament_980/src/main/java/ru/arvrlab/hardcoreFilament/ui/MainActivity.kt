@@ -17,6 +17,7 @@ import androidx.appcompat.app.AppCompatActivity
 import androidx.core.view.doOnLayout
 import org.xmlpull.v1.XmlPullParserException
 import ru.arvrlab.hardcoreFilament.*
+import ru.arvrlab.hardcoreFilament.filament.CommandRing
 import ru.arvrlab.hardcoreFilament.filament.FilamentHelper
 import ru.arvrlab.hardcoreFilament.filament.FilamentHelper.RendererCallback
 import ru.arvrlab.hardcoreFilament.filament.HelloFilament
@@ -76,6 +77,7 @@ class MainActivity : AppCompatActivity() {
     private val mMaterials = HashMap<String, Material>()
     private val mMaterial = Material()
     private var mMaterialNeedsUpdate = false
+    private val mCommands = CommandRing()
     private var mObjectRotation = true
     private var mCameraRotation = false
     private var mCameraSurfaceTexture = SurfaceTexture(0)
@@ -146,25 +148,25 @@ class MainActivity : AppCompatActivity() {
     }
 
     private val frameCallback = object : FrameCallback{
-        override fun doFrame(p0: Long) {
+        override fun doFrame(frameTimeNanos: Long) {
             mChoreographer.postFrameCallback(this)
             if (sFilamentHelper.isReadyToRender) {
                 if (mStreamMode == StreamMode.TEXTURE_ID && mUseCameraTexture) mCameraSurfaceTexture.updateTexImage()
                 if (mMaterialNeedsUpdate) {
                     mMaterialNeedsUpdate = false
                     val material = mMaterial
-                    HelloFilament.updateMaterial(
+                    mCommands.updateMaterial(
                         material.metallic,
                         material.roughness,
                         material.clearCoat
                     )
-                    HelloFilament.updateMaterialAlbedo(
+                    mCommands.updateMaterialAlbedo(
                         material.albedo[0],
                         material.albedo[1],
                         material.albedo[2]
                     )
                 }
-                HelloFilament.render(true, false)
+                HelloFilament.render(true, false, frameTimeNanos)
 
                         //mObjectRotation, mCameraRotation)
             }
@@ -188,6 +190,14 @@ class MainActivity : AppCompatActivity() {
             0,
             mStreamMode == StreamMode.SURFACE_TEXTURE
         )
+        HelloFilament.setCommandRing(mCommands.buffer)
+        windowManager.defaultDisplay.let { display ->
+            HelloFilament.setDisplayInfo(
+                display.refreshRate,
+                display.presentationDeadlineNanos,
+                display.appVsyncOffsetNanos
+            )
+        }
         if (mStreamMode == StreamMode.SURFACE_TEXTURE) {
             // this is to emulate API 26, which allows to start detached.
             mCameraSurfaceTexture.detachFromGLContext()
@@ -198,7 +208,7 @@ class MainActivity : AppCompatActivity() {
         renderView?.doOnLayout {
             viewModel.loadEnvironment(assets, "")
             viewModel.loadModel(assets, "cube_1m_centered.glb")
-            HelloFilament.updateTransform()
+            mCommands.updateTransform()
             /*AssetReader.getFileFromAssets(applicationContext, "wolf_centered_3.glb", "models/")
                 .run {
                     val modelSize = readBytes().size
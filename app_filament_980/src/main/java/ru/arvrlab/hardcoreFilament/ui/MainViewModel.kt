@@ -17,8 +17,8 @@ class MainViewModel: ViewModel() {
         HelloFilament.loadIbl(assets, "env/$env")
     }
 
-    fun loadMesh(assets: AssetManager, mesh: String) {
-        HelloFilament.loadMesh(
+    fun loadMesh(assets: AssetManager, mesh: String): Int {
+        return HelloFilament.loadMesh(
             assets,
             "models/$mesh"
         )//.filamesh
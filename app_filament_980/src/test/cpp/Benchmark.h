@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_TEST_BENCHMARK_H
+#define TNT_FILAMENT_SAMPLE_TEST_BENCHMARK_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+
+// Helpers shared by the host tests, which return the number of failed expectations from main().
+namespace test {
+
+inline int& failures() noexcept {
+    static int sFailures = 0;
+    return sFailures;
+}
+
+inline void expect(bool condition, const char* what) noexcept {
+    if (!condition) {
+        fprintf(stderr, "FAILED: %s\n", what);
+        failures()++;
+    }
+}
+
+// Nanoseconds per call of f, the best of a few runs of count calls. Only meant to compare
+// implementations on the same host, the tests never assert on timings.
+template<typename F>
+double measure(size_t count, F&& f) {
+    using clock = std::chrono::steady_clock;
+    double best = 0.0;
+    for (size_t run = 0; run < 5; run++) {
+        auto const start = clock::now();
+        for (size_t i = 0; i < count; i++) {
+            f();
+        }
+        std::chrono::duration<double, std::nano> const elapsed = clock::now() - start;
+        double const perCall = elapsed.count() / double(count);
+        best = run ? std::min(best, perCall) : perCall;
+    }
+    return best;
+}
+
+} // namespace test
+
+#endif // TNT_FILAMENT_SAMPLE_TEST_BENCHMARK_H
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The bulk kernels of image/ColorTransform.h built with their NEON paths, in another namespace so
+// that they link next to the scalar ones. On hosts without NEON, neon/arm_neon.h emulates the
+// intrinsics, as on AArch64 so that the RGBM encoder's vector path is covered too.
+
+// everything else the header includes, without the NEON paths of math/half.h
+#include <image/LinearImage.h>
+#include <utils/compiler.h>
+#include <math/scalar.h>
+#include <math/vec3.h>
+#include <math/vec4.h>
+#include <math/half.h>
+
+#include <algorithm>
+#include <memory>
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(__ARM_NEON)
+#define __ARM_NEON 1
+#define __aarch64__ 1
+#endif
+
+namespace image_neon {
+using image::LinearImage;
+}
+
+#define image image_neon
+#include <image/ColorTransform.h>
+#undef image
+
+using filament::math::float3;
+using filament::math::float4;
+
+void sRGBToLinearWithNeon(float const* src, float* dst, size_t count) {
+    image_neon::sRGBToLinear(src, dst, count);
+}
+
+void linearTosRGBWithNeon(float const* src, float* dst, size_t count) {
+    image_neon::linearTosRGB(src, dst, count);
+}
+
+void linearTosRGBWithNeon(float const* src, uint8_t* dst, size_t count) {
+    image_neon::linearTosRGB(src, dst, count);
+}
+
+void linearToRGBMWithNeon(float3 const* src, float4* dst, size_t count) {
+    image_neon::linearToRGBM(src, dst, count);
+}
+
+void RGBMtoLinearWithNeon(float4 const* src, float3* dst, size_t count) {
+    image_neon::RGBMtoLinear(src, dst, count);
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <image/ColorTransform.h>
+
+#include "Benchmark.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <vector>
+
+using namespace filament::math;
+
+// ColorTransformNeon.cpp
+void sRGBToLinearWithNeon(float const* src, float* dst, size_t count);
+void linearTosRGBWithNeon(float const* src, float* dst, size_t count);
+void linearTosRGBWithNeon(float const* src, uint8_t* dst, size_t count);
+void linearToRGBMWithNeon(float3 const* src, float4* dst, size_t count);
+void RGBMtoLinearWithNeon(float4 const* src, float3* dst, size_t count);
+
+namespace {
+
+// The curves are documented within ~4e-6 of the exact ones, with some margin.
+constexpr double MAX_RELATIVE_ERROR = 5e-6;
+
+constexpr size_t COUNT = 1u << 20;
+
+// Exact curves, in double precision.
+double linearTosRGBReference(double linear) {
+    return linear <= 0.0031308 ? linear * 12.92 : 1.055 * pow(linear, 1.0 / 2.4) - 0.055;
+}
+
+double sRGBToLinearReference(double sRGB) {
+    return sRGB <= 0.04045 ? sRGB / 12.92 : pow((sRGB + 0.055) / 1.055, 2.4);
+}
+
+// Evenly spread over [-0.1, 1.5), which covers both segments of the curves, out of range values
+// and every 8-bit rounding boundary many times.
+std::vector<float> createValues() {
+    std::vector<float> values(COUNT);
+    for (size_t i = 0; i < COUNT; i++) {
+        values[i] = -0.1f + 1.6f * float(i) / float(COUNT);
+    }
+    return values;
+}
+
+template<typename REFERENCE>
+double getMaxRelativeError(std::vector<float> const& src, std::vector<float> const& dst,
+        REFERENCE reference) {
+    double maxError = 0.0;
+    for (size_t i = 0; i < src.size(); i++) {
+        double const expected = reference(src[i]);
+        // absolute near 0, where the linear segments are exact anyway
+        double const error = fabs(dst[i] - expected) / std::max(fabs(expected), 1e-3);
+        maxError = std::max(maxError, error);
+    }
+    return maxError;
+}
+
+void testCurves(const char* path,
+        void (*toLinear)(float const*, float*, size_t),
+        void (*tosRGB)(float const*, float*, size_t),
+        void (*tosRGB8)(float const*, uint8_t*, size_t)) {
+    std::vector<float> const src = createValues();
+    std::vector<float> dst(src.size());
+    char what[96];
+
+    toLinear(src.data(), dst.data(), src.size());
+    double const toLinearError = getMaxRelativeError(src, dst, sRGBToLinearReference);
+    snprintf(what, sizeof(what), "%s sRGB to linear within %g (max error %.2g)",
+            path, MAX_RELATIVE_ERROR, toLinearError);
+    test::expect(toLinearError <= MAX_RELATIVE_ERROR, what);
+
+    tosRGB(src.data(), dst.data(), src.size());
+    double const tosRGBError = getMaxRelativeError(src, dst, linearTosRGBReference);
+    snprintf(what, sizeof(what), "%s linear to sRGB within %g (max error %.2g)",
+            path, MAX_RELATIVE_ERROR, tosRGBError);
+    test::expect(tosRGBError <= MAX_RELATIVE_ERROR, what);
+
+    // only values landing next to a rounding boundary may go either way
+    std::vector<uint8_t> sRGB8(src.size());
+    tosRGB8(src.data(), sRGB8.data(), src.size());
+    int maxDifference = 0;
+    for (size_t i = 0; i < src.size(); i++) {
+        double const expected = std::min(std::max(linearTosRGBReference(src[i]), 0.0), 1.0);
+        int const difference = abs(int(sRGB8[i]) - int(lround(expected * 255.0)));
+        maxDifference = std::max(maxDifference, difference);
+    }
+    snprintf(what, sizeof(what), "%s linear to 8-bit sRGB within 1 LSB (max difference %d)",
+            path, maxDifference);
+    test::expect(maxDifference <= 1, what);
+
+    printf("%-6s max relative error %.2g to linear, %.2g to sRGB, %d LSB to 8-bit sRGB\n",
+            path, toLinearError, tosRGBError, maxDifference);
+}
+
+void testTable() {
+    std::vector<uint8_t> src(256);
+    std::vector<float> dst(256);
+    for (size_t i = 0; i < 256; i++) src[i] = uint8_t(i);
+    image::sRGBToLinear(src.data(), dst.data(), src.size());
+    bool identical = true;
+    for (size_t i = 0; i < 256; i++) {
+        identical = identical && dst[i] == image::sRGBToLinear(float3(i / 255.0f)).r;
+    }
+    test::expect(identical, "8-bit sRGB to linear is identical to sRGBToLinear()");
+}
+
+// The RGBM kernels must give what the per-pixel functions give, HDR values included.
+void testRGBM(const char* path,
+        void (*encode)(float3 const*, float4*, size_t),
+        void (*decode)(float4 const*, float3*, size_t)) {
+    std::vector<float3> colors(1027);
+    for (size_t i = 0; i < colors.size(); i++) {
+        float const t = float(i) / float(colors.size());
+        colors[i] = float3(t * 40.0f, t * t, 0.001f * (1.0f - t));
+    }
+    std::vector<float4> rgbm(colors.size());
+    std::vector<float3> linear(colors.size());
+    encode(colors.data(), rgbm.data(), colors.size());
+    decode(rgbm.data(), linear.data(), rgbm.size());
+
+    bool encoded = true;
+    bool decoded = true;
+    for (size_t i = 0; i < colors.size(); i++) {
+        encoded = encoded && all(equal(rgbm[i], image::linearToRGBM(colors[i])));
+        decoded = decoded && all(equal(linear[i], image::RGBMtoLinear(rgbm[i])));
+    }
+    char what[96];
+    snprintf(what, sizeof(what), "%s RGBM encoding is identical to linearToRGBM()", path);
+    test::expect(encoded, what);
+    snprintf(what, sizeof(what), "%s RGBM decoding is identical to RGBMtoLinear()", path);
+    test::expect(decoded, what);
+}
+
+// Millions of values per second of the per-value functions and of both kernel paths. On hosts
+// without NEON its numbers are the emulation's, the ones to look at come from an ARM host.
+void benchmark() {
+    std::vector<float> const src = createValues();
+    std::vector<float> dst(src.size());
+    std::vector<uint8_t> dst8(src.size());
+    auto rate = [](double ns) { return double(COUNT) * 1e3 / ns; };
+
+    double const perValue = test::measure(1, [&]() {
+        for (size_t i = 0; i < COUNT; i++) {
+            dst[i] = image::linearTosRGB(src[i]);
+        }
+    });
+    double const scalar = test::measure(1, [&]() {
+        image::linearTosRGB(src.data(), dst.data(), COUNT);
+    });
+    double const neon = test::measure(1, [&]() {
+        linearTosRGBWithNeon(src.data(), dst.data(), COUNT);
+    });
+    printf("linear to sRGB     pow %7.1f  scalar %7.1f  NEON %7.1f Mvalues/s\n",
+            rate(perValue), rate(scalar), rate(neon));
+
+    double const perValue8 = test::measure(1, [&]() {
+        for (size_t i = 0; i < COUNT; i++) {
+            dst8[i] = uint8_t(saturate(image::linearTosRGB(src[i])) * 255.0f + 0.5f);
+        }
+    });
+    double const scalar8 = test::measure(1, [&]() {
+        image::linearTosRGB(src.data(), dst8.data(), COUNT);
+    });
+    double const neon8 = test::measure(1, [&]() {
+        linearTosRGBWithNeon(src.data(), dst8.data(), COUNT);
+    });
+    printf("linear to sRGB8    pow %7.1f  scalar %7.1f  NEON %7.1f Mvalues/s\n",
+            rate(perValue8), rate(scalar8), rate(neon8));
+
+    double const perValueLinear = test::measure(1, [&]() {
+        for (size_t i = 0; i < COUNT; i++) {
+            dst[i] = image::sRGBToLinear(float3(src[i])).r;
+        }
+    });
+    double const scalarLinear = test::measure(1, [&]() {
+        image::sRGBToLinear(src.data(), dst.data(), COUNT);
+    });
+    double const neonLinear = test::measure(1, [&]() {
+        sRGBToLinearWithNeon(src.data(), dst.data(), COUNT);
+    });
+    printf("sRGB to linear     pow %7.1f  scalar %7.1f  NEON %7.1f Mvalues/s\n",
+            rate(perValueLinear), rate(scalarLinear), rate(neonLinear));
+}
+
+} // anonymous namespace
+
+int main() {
+    testTable();
+    testCurves("scalar", image::sRGBToLinear, image::linearTosRGB, image::linearTosRGB);
+    testCurves("NEON", sRGBToLinearWithNeon, linearTosRGBWithNeon, linearTosRGBWithNeon);
+    testRGBM("scalar", image::linearToRGBM, image::RGBMtoLinear);
+    testRGBM("NEON", linearToRGBMWithNeon, RGBMtoLinearWithNeon);
+
+#if defined(__ARM_NEON)
+    printf("Bulk color transforms, native NEON\n");
+#else
+    printf("Bulk color transforms, emulated NEON\n");
+#endif
+    benchmark();
+    return test::failures() ? 1 : 0;
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The encoder built with its NEON path, under another name so that it links next to the scalar
+// one. On hosts without NEON, neon/arm_neon.h emulates the few intrinsics it uses.
+
+#if !defined(__ARM_NEON)
+#define __ARM_NEON 1
+#endif
+
+#define Etc2Encoder Etc2EncoderNeon
+#include "Etc2Encoder.cpp"
+#undef Etc2Encoder
+
+void encodeWithNeon(uint8_t const* rgba, uint32_t width, uint32_t height, bool alpha, bool high,
+        uint8_t* out) {
+    Etc2EncoderNeon encoder;
+    encoder.setQuality(high ? Etc2EncoderNeon::Quality::HIGH : Etc2EncoderNeon::Quality::FAST);
+    encoder.encode(rgba, width, height, alpha, out);
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Etc2Encoder.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <vector>
+
+// Etc2EncoderNeon.cpp
+void encodeWithNeon(uint8_t const* rgba, uint32_t width, uint32_t height, bool alpha, bool high,
+        uint8_t* out);
+
+namespace {
+
+// Below the quality of either mode on the test image, with some margin.
+constexpr double MIN_PSNR_FAST = 35.0;
+constexpr double MIN_PSNR_HIGH = 35.5;
+
+int gFailures = 0;
+
+void expect(bool condition, const char* what, const char* image, const char* quality) {
+    if (!condition) {
+        fprintf(stderr, "FAILED: %s (%s image, %s quality)\n", what, image, quality);
+        gFailures++;
+    }
+}
+
+// Smooth gradients with a few hard edges and some noise, the size isn't a multiple of 4 so that
+// the edge blocks are covered too.
+std::vector<uint8_t> createImage(uint32_t width, uint32_t height, bool alpha) {
+    std::vector<uint8_t> rgba(size_t(width) * height * 4);
+    uint32_t seed = 1;
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            seed = seed * 1664525u + 1013904223u;
+            int32_t const noise = int32_t(seed >> 28) - 8;
+            bool const checker = ((x / 16) + (y / 16)) & 1;
+            uint8_t* p = &rgba[(size_t(y) * width + x) * 4];
+            p[0] = uint8_t(x * 255 / width);
+            p[1] = uint8_t(y * 255 / height);
+            p[2] = uint8_t(checker ? 200 + noise : 40 + noise);
+            p[3] = alpha ? uint8_t((x + y) * 255 / (width + height)) : uint8_t(255);
+        }
+    }
+    return rgba;
+}
+
+double getPsnr(std::vector<uint8_t> const& a, std::vector<uint8_t> const& b) {
+    double error = 0.0;
+    for (size_t i = 0; i < a.size(); i++) {
+        double const d = double(a[i]) - double(b[i]);
+        error += d * d;
+    }
+    double const mse = error / double(a.size());
+    return mse == 0.0 ? INFINITY : 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+void testRoundTrip(bool alpha, bool high) {
+    constexpr uint32_t width = 70;
+    constexpr uint32_t height = 45;
+    const char* const image = alpha ? "RGBA" : "RGB";
+    const char* const quality = high ? "high" : "fast";
+
+    std::vector<uint8_t> const rgba = createImage(width, height, alpha);
+    expect(Etc2Encoder::isOpaque(rgba.data(), width * height) == !alpha, "isOpaque", image,
+            quality);
+
+    size_t const size = Etc2Encoder::getEncodedSize(width, height, alpha);
+    std::vector<uint8_t> blocks(size);
+    Etc2Encoder encoder;
+    encoder.setQuality(high ? Etc2Encoder::Quality::HIGH : Etc2Encoder::Quality::FAST);
+    encoder.encode(rgba.data(), width, height, alpha, blocks.data());
+
+    std::vector<uint8_t> neonBlocks(size);
+    encodeWithNeon(rgba.data(), width, height, alpha, high, neonBlocks.data());
+    expect(blocks == neonBlocks, "NEON and scalar encodings are identical", image, quality);
+
+    std::vector<uint8_t> decoded(rgba.size());
+    expect(Etc2Encoder::decode(blocks.data(), width, height, alpha, decoded.data()),
+            "decode", image, quality);
+    double const psnr = getPsnr(rgba, decoded);
+    printf("%s image, %s quality: %.2f dB\n", image, quality, psnr);
+    expect(psnr >= (high ? MIN_PSNR_HIGH : MIN_PSNR_FAST), "PSNR", image, quality);
+}
+
+} // anonymous namespace
+
+int main() {
+    for (bool alpha : { false, true }) {
+        for (bool high : { false, true }) {
+            testRoundTrip(alpha, high);
+        }
+    }
+    return gFailures ? 1 : 0;
+}
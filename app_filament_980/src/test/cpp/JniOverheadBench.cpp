@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Per call overhead of wrapping Java buffers and of their release callbacks, with the JNI
+// stand-in of jni/. The stand-in is much cheaper than a JVM, the numbers are the native side's
+// share; the lookups per call are what a JVM would add on top.
+
+#include "Benchmark.h"
+
+#include "CallbackUtils.h"
+#include "NioUtils.h"
+
+#include <jni.h>
+
+#include <vector>
+
+namespace {
+
+constexpr size_t CALLS = 100000;
+// callbacks completed between two flushes, about a frame's worth of uploads
+constexpr size_t CALLS_PER_FLUSH = 64;
+
+void report(const char* name, double ns, uint64_t lookups) {
+    printf("%-40s %8.1f ns/call, %4.1f lookups/call\n", name, ns,
+            double(lookups) / double(CALLS * 5));
+}
+
+} // anonymous namespace
+
+int main() {
+    JNIEnv env;
+    initCallbackJni(&env);
+    AutoBuffer::init(&env);
+
+    std::vector<uint8_t> data(4096);
+    jnishim::ByteBuffer direct;
+    direct.array.data = data.data();
+    direct.direct = true;
+    jnishim::ByteBuffer wrapped;
+    wrapped.array.data = data.data();
+
+    uint64_t lookups = jnishim::getLookupCount();
+    double ns = test::measure(CALLS, [&]() {
+        AutoBuffer buffer(&env, &direct, jint(data.size()));
+    });
+    uint64_t count = jnishim::getLookupCount() - lookups;
+    report("AutoBuffer, direct buffer", ns, count);
+    test::expect(count == 0, "AutoBuffer looks nothing up");
+
+    lookups = jnishim::getLookupCount();
+    ns = test::measure(CALLS, [&]() {
+        AutoBuffer buffer(&env, &wrapped, jint(data.size()));
+        test::expect(buffer.getData() == data.data(), "AutoBuffer maps the array");
+    });
+    count = jnishim::getLookupCount() - lookups;
+    report("AutoBuffer, wrapped array", ns, count);
+    test::expect(count == 0, "AutoBuffer looks nothing up");
+
+    // what every AutoBuffer paid before the IDs were cached
+    lookups = jnishim::getLookupCount();
+    ns = test::measure(CALLS, [&]() {
+        AutoBuffer::terminate(&env);
+        AutoBuffer::init(&env);
+        AutoBuffer buffer(&env, &direct, jint(data.size()));
+    });
+    count = jnishim::getLookupCount() - lookups;
+    report("AutoBuffer, resolving its IDs", ns, count);
+
+    lookups = jnishim::getLookupCount();
+    size_t pending = 0;
+    ns = test::measure(CALLS, [&]() {
+        JniBufferCallback* callback = JniBufferCallback::make(nullptr, &env, nullptr, nullptr,
+                AutoBuffer(&env, &direct, jint(data.size())));
+        JniBufferCallback::invoke(nullptr, 0, callback);
+        if (++pending == CALLS_PER_FLUSH) {
+            JniBufferCallback::flush(&env);
+            pending = 0;
+        }
+    });
+    JniBufferCallback::flush(&env);
+    count = jnishim::getLookupCount() - lookups;
+    report("JniBufferCallback, make to flush", ns, count);
+    test::expect(count == 0, "JniBufferCallback looks nothing up");
+
+    AutoBuffer::terminate(&env);
+    terminateCallbackJni(&env);
+    test::expect(jnishim::getGlobalRefCount() == 0, "every global reference is deleted");
+    return test::failures() ? 1 : 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The parts of Filament's libutils that the native code under test uses but that aren't in its
+// headers. The app links the Android build of the library instead.
+
+#include <utils/Allocator.h>
+
+namespace utils {
+
+AtomicFreeList::AtomicFreeList(void* begin, void* end,
+        size_t elementSize, size_t alignment, size_t extra) noexcept {
+    void* const p = pointermath::align(begin, alignment, extra);
+    void* const n = pointermath::align(pointermath::add(p, elementSize), alignment, extra);
+    assert(p >= begin && p < end);
+    assert(n >= begin && n < end && n > p);
+
+    size_t const d = uintptr_t(n) - uintptr_t(p);
+    size_t const num = (uintptr_t(end) - uintptr_t(p)) / d;
+
+    // chains the elements in address order
+    Node* const head = static_cast<Node*>(p);
+    mStorage = head;
+    mHead.store({ 0, 0 });
+    Node* cur = head;
+    for (size_t i = 1; i < num; i++) {
+        Node* const next = pointermath::add(cur, d);
+        cur->next.store(next, std::memory_order_relaxed);
+        cur = next;
+    }
+    assert(pointermath::add(cur, d) <= end);
+    cur->next.store(nullptr, std::memory_order_relaxed);
+}
+
+} // namespace utils
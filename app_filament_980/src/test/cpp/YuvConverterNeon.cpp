@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The converter built with its NEON path, under another name so that it links next to the scalar
+// one. On hosts without NEON, neon/arm_neon.h emulates the intrinsics it uses.
+
+#if !defined(__ARM_NEON)
+#define __ARM_NEON 1
+#endif
+
+#define YuvConverter YuvConverterNeon
+#include "YuvConverter.cpp"
+#undef YuvConverter
+
+// takes the planes field by field, YuvConverter::Planes is another type in this file
+void convertWithNeon(uint8_t const* y, uint8_t const* u, uint8_t const* v, uint32_t yRowStride,
+        uint32_t uvRowStride, uint32_t uvPixelStride, uint32_t width, uint32_t height,
+        uint8_t* rgba) {
+    YuvConverterNeon::Planes planes;
+    planes.y = y;
+    planes.u = u;
+    planes.v = v;
+    planes.yRowStride = yRowStride;
+    planes.uvRowStride = uvRowStride;
+    planes.uvPixelStride = uvPixelStride;
+    planes.width = width;
+    planes.height = height;
+    YuvConverterNeon::convert(planes, rgba);
+}
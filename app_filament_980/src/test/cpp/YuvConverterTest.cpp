@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "YuvConverter.h"
+
+#include "Benchmark.h"
+
+#include <stdio.h>
+
+#include <vector>
+
+// YuvConverterNeon.cpp
+void convertWithNeon(uint8_t const* y, uint8_t const* u, uint8_t const* v, uint32_t yRowStride,
+        uint32_t uvRowStride, uint32_t uvPixelStride, uint32_t width, uint32_t height,
+        uint8_t* rgba);
+
+namespace {
+
+void convertNeon(YuvConverter::Planes const& planes, uint8_t* rgba) {
+    convertWithNeon(planes.y, planes.u, planes.v, planes.yRowStride, planes.uvRowStride,
+            planes.uvPixelStride, planes.width, planes.height, rgba);
+}
+
+// A camera frame with random samples and padded rows. Semi-planar frames are laid out as NV21,
+// the U plane starts one byte into the interleaved VU one.
+struct Frame {
+    std::vector<uint8_t> y;
+    std::vector<uint8_t> uv[2];
+    YuvConverter::Planes planes;
+};
+
+Frame createFrame(uint32_t width, uint32_t height, bool semiPlanar, uint32_t padding) {
+    uint32_t seed = width * 31 + height;
+    auto random = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return uint8_t(seed >> 24);
+    };
+    uint32_t const chromaWidth = (width + 1) / 2;
+    uint32_t const chromaHeight = (height + 1) / 2;
+
+    Frame frame;
+    YuvConverter::Planes& planes = frame.planes;
+    planes.width = width;
+    planes.height = height;
+    planes.yRowStride = width + padding;
+    planes.uvPixelStride = semiPlanar ? 2 : 1;
+    planes.uvRowStride = chromaWidth * planes.uvPixelStride + padding;
+
+    // the last row isn't padded, as in the images given by the camera
+    frame.y.resize(size_t(planes.yRowStride) * (height - 1) + width);
+    for (uint8_t& sample : frame.y) sample = random();
+    size_t const lastRow = semiPlanar ? chromaWidth * 2 - 1 : chromaWidth;
+    for (std::vector<uint8_t>& plane : frame.uv) {
+        plane.resize(size_t(planes.uvRowStride) * (chromaHeight - 1) + lastRow);
+        for (uint8_t& sample : plane) sample = random();
+        if (semiPlanar) break;
+    }
+
+    planes.y = frame.y.data();
+    if (semiPlanar) {
+        planes.v = frame.uv[0].data();
+        planes.u = frame.uv[0].data() + 1;
+    } else {
+        planes.u = frame.uv[0].data();
+        planes.v = frame.uv[1].data();
+    }
+    return frame;
+}
+
+void testEquivalence(uint32_t width, uint32_t height, bool semiPlanar, uint32_t padding) {
+    Frame const frame = createFrame(width, height, semiPlanar, padding);
+    std::vector<uint8_t> scalar(size_t(width) * height * 4);
+    std::vector<uint8_t> neon(scalar.size());
+    YuvConverter::convert(frame.planes, scalar.data());
+    convertNeon(frame.planes, neon.data());
+
+    char what[96];
+    snprintf(what, sizeof(what), "NEON and scalar conversions are identical (%ux%u, %s)",
+            width, height, semiPlanar ? "semi-planar" : "planar");
+    test::expect(scalar == neon, what);
+}
+
+// Milliseconds per frame of both paths. On hosts without NEON its numbers are the emulation's and
+// only tell that it ran, the ones to look at come from an ARM host.
+void benchmark(const char* name, uint32_t width, uint32_t height, bool semiPlanar) {
+    Frame const frame = createFrame(width, height, semiPlanar, 0);
+    std::vector<uint8_t> rgba(size_t(width) * height * 4);
+    size_t const count = std::max(size_t(1), size_t(3840 * 2160) / (size_t(width) * height));
+    double const megapixels = double(width) * height * 1e-6;
+    double const scalar = test::measure(count, [&]() {
+        YuvConverter::convert(frame.planes, rgba.data());
+    }) * 1e-6;
+    double const neon = test::measure(count, [&]() {
+        convertNeon(frame.planes, rgba.data());
+    }) * 1e-6;
+    printf("%-5s %-11s  scalar %7.2f ms (%6.1f Mpx/s)  NEON %7.2f ms (%6.1f Mpx/s)\n",
+            name, semiPlanar ? "semi-planar" : "planar",
+            scalar, megapixels * 1e3 / scalar, neon, megapixels * 1e3 / neon);
+}
+
+} // anonymous namespace
+
+int main() {
+    for (bool semiPlanar : { false, true }) {
+        // multiples of the 16 pixel blocks, a scalar tail, odd sizes and a single column
+        testEquivalence(64, 4, semiPlanar, 0);
+        testEquivalence(1282, 7, semiPlanar, 0);
+        testEquivalence(37, 9, semiPlanar, 27);
+        testEquivalence(33, 3, semiPlanar, 5);
+        testEquivalence(1, 5, semiPlanar, 3);
+    }
+
+#if defined(__ARM_NEON)
+    printf("YUV to RGBA, native NEON\n");
+#else
+    printf("YUV to RGBA, emulated NEON\n");
+#endif
+    for (bool semiPlanar : { false, true }) {
+        benchmark("720p", 1280, 720, semiPlanar);
+        benchmark("1080p", 1920, 1080, semiPlanar);
+        benchmark("4K", 3840, 2160, semiPlanar);
+    }
+    return test::failures() ? 1 : 0;
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <jni.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct _jmethodID {
+    std::string name;
+};
+
+namespace {
+
+std::atomic<uint64_t> gLookups{ 0 };
+std::atomic<int64_t> gGlobalRefs{ 0 };
+
+// Looked up by name as a JVM would, entries are never removed so their addresses are stable.
+std::mutex gLock;
+std::unordered_map<std::string, _jclass> gClasses;
+std::unordered_map<std::string, _jmethodID> gMethods;
+
+jmethodID getMethod(jclass clazz, const char* name, const char* signature) {
+    gLookups++;
+    std::lock_guard<std::mutex> guard(gLock);
+    std::string key = std::to_string(uintptr_t(clazz)) + "." + name + signature;
+    _jmethodID& method = gMethods[key];
+    method.name = name;
+    return &method;
+}
+
+template<typename T>
+T* getElements(jarray array) {
+    return reinterpret_cast<T*>(static_cast<jnishim::ByteArray*>(array)->data);
+}
+
+bool is(jmethodID method, const char* name) {
+    return method && method->name == name;
+}
+
+} // anonymous namespace
+
+namespace jnishim {
+
+uint64_t getLookupCount() noexcept {
+    return gLookups.load();
+}
+
+int64_t getGlobalRefCount() noexcept {
+    return gGlobalRefs.load();
+}
+
+} // namespace jnishim
+
+jclass JNIEnv::FindClass(const char* name) {
+    gLookups++;
+    std::lock_guard<std::mutex> guard(gLock);
+    return &gClasses[name];
+}
+
+jmethodID JNIEnv::GetMethodID(jclass clazz, const char* name, const char* signature) {
+    return getMethod(clazz, name, signature);
+}
+
+jmethodID JNIEnv::GetStaticMethodID(jclass clazz, const char* name, const char* signature) {
+    return getMethod(clazz, name, signature);
+}
+
+jobject JNIEnv::NewGlobalRef(jobject object) {
+    if (object) {
+        gGlobalRefs++;
+    }
+    return object;
+}
+
+void JNIEnv::DeleteGlobalRef(jobject object) {
+    if (object) {
+        gGlobalRefs--;
+    }
+}
+
+void JNIEnv::DeleteLocalRef(jobject) {
+}
+
+jboolean JNIEnv::IsInstanceOf(jobject, jclass) {
+    return false;
+}
+
+// Only the NioUtils methods are called on classes, with byte buffers.
+
+jint JNIEnv::CallStaticIntMethod(jclass, jmethodID method, ...) {
+    // getBufferType() is BYTE, getBaseArrayOffset() 0
+    (void) method;
+    return 0;
+}
+
+jlong JNIEnv::CallStaticLongMethod(jclass, jmethodID method, ...) {
+    // getBasePointer(buffer, address, shift) is the address
+    va_list args;
+    va_start(args, method);
+    va_arg(args, jobject);
+    jlong const address = va_arg(args, jlong);
+    va_end(args);
+    return is(method, "getBasePointer") ? address : 0;
+}
+
+jobject JNIEnv::CallStaticObjectMethod(jclass, jmethodID method, ...) {
+    // getBaseArray(buffer)
+    va_list args;
+    va_start(args, method);
+    auto* const buffer = static_cast<jnishim::ByteBuffer*>(va_arg(args, jobject));
+    va_end(args);
+    return is(method, "getBaseArray") ? &buffer->array : nullptr;
+}
+
+jboolean JNIEnv::CallBooleanMethod(jobject, jmethodID, ...) {
+    return true;
+}
+
+void JNIEnv::CallVoidMethod(jobject, jmethodID, ...) {
+}
+
+void* JNIEnv::GetDirectBufferAddress(jobject buffer) {
+    jnishim::ByteBuffer const* b = static_cast<jnishim::ByteBuffer const*>(buffer);
+    return b->direct ? b->array.data : nullptr;
+}
+
+jbyte* JNIEnv::GetByteArrayElements(jbyteArray array, jboolean*) {
+    return getElements<jbyte>(array);
+}
+
+jchar* JNIEnv::GetCharArrayElements(jcharArray array, jboolean*) {
+    return getElements<jchar>(array);
+}
+
+jshort* JNIEnv::GetShortArrayElements(jshortArray array, jboolean*) {
+    return getElements<jshort>(array);
+}
+
+jint* JNIEnv::GetIntArrayElements(jintArray array, jboolean*) {
+    return getElements<jint>(array);
+}
+
+jlong* JNIEnv::GetLongArrayElements(jlongArray array, jboolean*) {
+    return getElements<jlong>(array);
+}
+
+jfloat* JNIEnv::GetFloatArrayElements(jfloatArray array, jboolean*) {
+    return getElements<jfloat>(array);
+}
+
+jdouble* JNIEnv::GetDoubleArrayElements(jdoubleArray array, jboolean*) {
+    return getElements<jdouble>(array);
+}
+
+void JNIEnv::ReleaseByteArrayElements(jbyteArray, jbyte*, jint) {
+}
+
+void JNIEnv::ReleaseCharArrayElements(jcharArray, jchar*, jint) {
+}
+
+void JNIEnv::ReleaseShortArrayElements(jshortArray, jshort*, jint) {
+}
+
+void JNIEnv::ReleaseIntArrayElements(jintArray, jint*, jint) {
+}
+
+void JNIEnv::ReleaseLongArrayElements(jlongArray, jlong*, jint) {
+}
+
+void JNIEnv::ReleaseFloatArrayElements(jfloatArray, jfloat*, jint) {
+}
+
+void JNIEnv::ReleaseDoubleArrayElements(jdoubleArray, jdouble*, jint) {
+}
+
+jint JavaVM::GetEnv(void** env, jint) {
+    static JNIEnv sEnv;
+    *env = &sEnv;
+    return JNI_OK;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_TEST_JNI_H
+#define TNT_FILAMENT_SAMPLE_TEST_JNI_H
+
+// A stand-in for the JNI header on hosts without a JVM. JNIEnv only has the functions the native
+// code calls, implemented by JniShim.cpp over plain C++ objects, and counts the ones that look
+// classes and methods up by name.
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define JNIEXPORT __attribute__((visibility("default")))
+#define JNICALL
+#define JNI_OK 0
+#define JNI_ABORT 2
+#define JNI_VERSION_1_6 0x00010006
+
+using jboolean = uint8_t;
+using jbyte = int8_t;
+using jchar = uint16_t;
+using jshort = int16_t;
+using jint = int32_t;
+using jlong = int64_t;
+using jfloat = float;
+using jdouble = double;
+
+class _jobject {};
+class _jclass : public _jobject {};
+class _jarray : public _jobject {};
+class _jbyteArray : public _jarray {};
+class _jcharArray : public _jarray {};
+class _jshortArray : public _jarray {};
+class _jintArray : public _jarray {};
+class _jlongArray : public _jarray {};
+class _jfloatArray : public _jarray {};
+class _jdoubleArray : public _jarray {};
+
+using jobject = _jobject*;
+using jclass = _jclass*;
+using jarray = _jarray*;
+using jbyteArray = _jbyteArray*;
+using jcharArray = _jcharArray*;
+using jshortArray = _jshortArray*;
+using jintArray = _jintArray*;
+using jlongArray = _jlongArray*;
+using jfloatArray = _jfloatArray*;
+using jdoubleArray = _jdoubleArray*;
+
+struct _jmethodID;
+using jmethodID = _jmethodID*;
+
+struct JNIEnv {
+    jclass FindClass(const char* name);
+    jmethodID GetMethodID(jclass clazz, const char* name, const char* signature);
+    jmethodID GetStaticMethodID(jclass clazz, const char* name, const char* signature);
+
+    jobject NewGlobalRef(jobject object);
+    void DeleteGlobalRef(jobject object);
+    void DeleteLocalRef(jobject object);
+    jboolean IsInstanceOf(jobject object, jclass clazz);
+
+    jint CallStaticIntMethod(jclass clazz, jmethodID method, ...);
+    jlong CallStaticLongMethod(jclass clazz, jmethodID method, ...);
+    jobject CallStaticObjectMethod(jclass clazz, jmethodID method, ...);
+    jboolean CallBooleanMethod(jobject object, jmethodID method, ...);
+    void CallVoidMethod(jobject object, jmethodID method, ...);
+
+    void* GetDirectBufferAddress(jobject buffer);
+
+    jbyte* GetByteArrayElements(jbyteArray array, jboolean* isCopy);
+    jchar* GetCharArrayElements(jcharArray array, jboolean* isCopy);
+    jshort* GetShortArrayElements(jshortArray array, jboolean* isCopy);
+    jint* GetIntArrayElements(jintArray array, jboolean* isCopy);
+    jlong* GetLongArrayElements(jlongArray array, jboolean* isCopy);
+    jfloat* GetFloatArrayElements(jfloatArray array, jboolean* isCopy);
+    jdouble* GetDoubleArrayElements(jdoubleArray array, jboolean* isCopy);
+    void ReleaseByteArrayElements(jbyteArray array, jbyte* elements, jint mode);
+    void ReleaseCharArrayElements(jcharArray array, jchar* elements, jint mode);
+    void ReleaseShortArrayElements(jshortArray array, jshort* elements, jint mode);
+    void ReleaseIntArrayElements(jintArray array, jint* elements, jint mode);
+    void ReleaseLongArrayElements(jlongArray array, jlong* elements, jint mode);
+    void ReleaseFloatArrayElements(jfloatArray array, jfloat* elements, jint mode);
+    void ReleaseDoubleArrayElements(jdoubleArray array, jdouble* elements, jint mode);
+};
+
+struct JavaVM {
+    jint GetEnv(void** env, jint version);
+};
+
+namespace jnishim {
+
+// A byte[] whose elements are data.
+struct ByteArray : public _jbyteArray {
+    uint8_t* data = nullptr;
+};
+
+// A java.nio.ByteBuffer, direct or wrapping array.
+struct ByteBuffer : public _jobject {
+    ByteArray array;
+    bool direct = false;
+};
+
+// FindClass(), GetMethodID() and GetStaticMethodID() calls so far.
+uint64_t getLookupCount() noexcept;
+
+// Global references currently held.
+int64_t getGlobalRefCount() noexcept;
+
+} // namespace jnishim
+
+#endif // TNT_FILAMENT_SAMPLE_TEST_JNI_H
@@ -0,0 +1,399 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_TEST_ARM_NEON_H
+#define TNT_FILAMENT_SAMPLE_TEST_ARM_NEON_H
+
+// Lane by lane emulation of the NEON intrinsics used by the app (Etc2Encoder, YuvConverter and
+// the bulk kernels of image/ColorTransform.h), for hosts without NEON. Only meant to check that
+// the NEON paths give the same results as the scalar ones, not to be fast.
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+template<typename T, int N>
+struct NeonVector {
+    T v[N];
+};
+
+using uint8x8_t = NeonVector<uint8_t, 8>;
+using uint8x16_t = NeonVector<uint8_t, 16>;
+using int16x4_t = NeonVector<int16_t, 4>;
+using int16x8_t = NeonVector<int16_t, 8>;
+using uint16x4_t = NeonVector<uint16_t, 4>;
+using uint16x8_t = NeonVector<uint16_t, 8>;
+using int32x4_t = NeonVector<int32_t, 4>;
+using uint32x4_t = NeonVector<uint32_t, 4>;
+using uint64x2_t = NeonVector<uint64_t, 2>;
+using float32x4_t = NeonVector<float, 4>;
+
+struct uint8x8x2_t { uint8x8_t val[2]; };
+struct uint8x16x4_t { uint8x16_t val[4]; };
+struct int16x8x2_t { int16x8_t val[2]; };
+struct float32x4x3_t { float32x4_t val[3]; };
+struct float32x4x4_t { float32x4_t val[4]; };
+
+template<typename R, typename F>
+inline R neonMap(F f) noexcept {
+    R r;
+    for (int i = 0; i < int(sizeof(r.v) / sizeof(r.v[0])); i++) {
+        r.v[i] = decltype(r.v[0] + 0)(f(i));
+    }
+    return r;
+}
+
+template<typename R, typename A>
+inline R neonCast(A a) noexcept {
+    static_assert(sizeof(R) == sizeof(A), "reinterpreting vectors of different sizes");
+    R r;
+    memcpy(&r, &a, sizeof(r));
+    return r;
+}
+
+// loads, stores and lanes
+
+inline uint8x8_t vld1_u8(uint8_t const* p) noexcept {
+    return neonMap<uint8x8_t>([=](int i) { return p[i]; });
+}
+
+inline uint8x16_t vld1q_u8(uint8_t const* p) noexcept {
+    return neonMap<uint8x16_t>([=](int i) { return p[i]; });
+}
+
+inline int16x8_t vld1q_s16(int16_t const* p) noexcept {
+    return neonMap<int16x8_t>([=](int i) { return p[i]; });
+}
+
+inline float32x4_t vld1q_f32(float const* p) noexcept {
+    return neonMap<float32x4_t>([=](int i) { return p[i]; });
+}
+
+inline uint8x8x2_t vld2_u8(uint8_t const* p) noexcept {
+    uint8x8x2_t r;
+    for (int i = 0; i < 8; i++) {
+        r.val[0].v[i] = p[i * 2];
+        r.val[1].v[i] = p[i * 2 + 1];
+    }
+    return r;
+}
+
+inline float32x4x3_t vld3q_f32(float const* p) noexcept {
+    float32x4x3_t r;
+    for (int i = 0; i < 4; i++) {
+        for (int c = 0; c < 3; c++) r.val[c].v[i] = p[i * 3 + c];
+    }
+    return r;
+}
+
+inline float32x4x4_t vld4q_f32(float const* p) noexcept {
+    float32x4x4_t r;
+    for (int i = 0; i < 4; i++) {
+        for (int c = 0; c < 4; c++) r.val[c].v[i] = p[i * 4 + c];
+    }
+    return r;
+}
+
+inline void vst1_u8(uint8_t* p, uint8x8_t a) noexcept {
+    for (int i = 0; i < 8; i++) p[i] = a.v[i];
+}
+
+inline void vst1q_u32(uint32_t* p, uint32x4_t a) noexcept {
+    for (int i = 0; i < 4; i++) p[i] = a.v[i];
+}
+
+inline void vst1q_f32(float* p, float32x4_t a) noexcept {
+    for (int i = 0; i < 4; i++) p[i] = a.v[i];
+}
+
+inline void vst4q_u8(uint8_t* p, uint8x16x4_t a) noexcept {
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) p[i * 4 + c] = a.val[c].v[i];
+    }
+}
+
+inline void vst3q_f32(float* p, float32x4x3_t a) noexcept {
+    for (int i = 0; i < 4; i++) {
+        for (int c = 0; c < 3; c++) p[i * 3 + c] = a.val[c].v[i];
+    }
+}
+
+inline void vst4q_f32(float* p, float32x4x4_t a) noexcept {
+    for (int i = 0; i < 4; i++) {
+        for (int c = 0; c < 4; c++) p[i * 4 + c] = a.val[c].v[i];
+    }
+}
+
+inline uint8x8_t vdup_n_u8(uint8_t x) noexcept {
+    return neonMap<uint8x8_t>([=](int) { return x; });
+}
+
+inline uint8x16_t vdupq_n_u8(uint8_t x) noexcept {
+    return neonMap<uint8x16_t>([=](int) { return x; });
+}
+
+inline int16x8_t vdupq_n_s16(int16_t x) noexcept {
+    return neonMap<int16x8_t>([=](int) { return x; });
+}
+
+inline int32x4_t vdupq_n_s32(int32_t x) noexcept {
+    return neonMap<int32x4_t>([=](int) { return x; });
+}
+
+inline uint32x4_t vdupq_n_u32(uint32_t x) noexcept {
+    return neonMap<uint32x4_t>([=](int) { return x; });
+}
+
+inline float32x4_t vdupq_n_f32(float x) noexcept {
+    return neonMap<float32x4_t>([=](int) { return x; });
+}
+
+inline uint8x8_t vget_low_u8(uint8x16_t a) noexcept {
+    return neonMap<uint8x8_t>([=](int i) { return a.v[i]; });
+}
+
+inline uint8x8_t vget_high_u8(uint8x16_t a) noexcept {
+    return neonMap<uint8x8_t>([=](int i) { return a.v[i + 8]; });
+}
+
+inline int16x4_t vget_low_s16(int16x8_t a) noexcept {
+    return neonMap<int16x4_t>([=](int i) { return a.v[i]; });
+}
+
+inline int16x4_t vget_high_s16(int16x8_t a) noexcept {
+    return neonMap<int16x4_t>([=](int i) { return a.v[i + 4]; });
+}
+
+inline uint8x16_t vcombine_u8(uint8x8_t a, uint8x8_t b) noexcept {
+    return neonMap<uint8x16_t>([=](int i) { return i < 8 ? a.v[i] : b.v[i - 8]; });
+}
+
+inline uint16x8_t vcombine_u16(uint16x4_t a, uint16x4_t b) noexcept {
+    return neonMap<uint16x8_t>([=](int i) { return i < 4 ? a.v[i] : b.v[i - 4]; });
+}
+
+inline int16x8x2_t vzipq_s16(int16x8_t a, int16x8_t b) noexcept {
+    int16x8x2_t r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i / 4].v[(i % 4) * 2] = a.v[i];
+        r.val[i / 4].v[(i % 4) * 2 + 1] = b.v[i];
+    }
+    return r;
+}
+
+#define vgetq_lane_u64(a, lane) ((a).v[lane])
+
+// reinterpretations and conversions
+
+inline int16x8_t vreinterpretq_s16_u16(uint16x8_t a) noexcept {
+    return neonCast<int16x8_t>(a);
+}
+
+inline uint32x4_t vreinterpretq_u32_s32(int32x4_t a) noexcept {
+    return neonCast<uint32x4_t>(a);
+}
+
+inline int32x4_t vreinterpretq_s32_u32(uint32x4_t a) noexcept {
+    return neonCast<int32x4_t>(a);
+}
+
+inline int32x4_t vreinterpretq_s32_f32(float32x4_t a) noexcept {
+    return neonCast<int32x4_t>(a);
+}
+
+inline float32x4_t vreinterpretq_f32_s32(int32x4_t a) noexcept {
+    return neonCast<float32x4_t>(a);
+}
+
+inline uint16x8_t vmovl_u8(uint8x8_t a) noexcept {
+    return neonMap<uint16x8_t>([=](int i) { return a.v[i]; });
+}
+
+inline uint16x4_t vmovn_u32(uint32x4_t a) noexcept {
+    return neonMap<uint16x4_t>([=](int i) { return uint16_t(a.v[i]); });
+}
+
+inline uint8x8_t vmovn_u16(uint16x8_t a) noexcept {
+    return neonMap<uint8x8_t>([=](int i) { return uint8_t(a.v[i]); });
+}
+
+inline uint8x8_t vqmovun_s16(int16x8_t a) noexcept {
+    return neonMap<uint8x8_t>([=](int i) {
+        return uint8_t(a.v[i] < 0 ? 0 : a.v[i] > 255 ? 255 : a.v[i]);
+    });
+}
+
+inline float32x4_t vcvtq_f32_s32(int32x4_t a) noexcept {
+    return neonMap<float32x4_t>([=](int i) { return float(a.v[i]); });
+}
+
+// float to integer conversions truncate and saturate, NaN gives 0
+inline int32x4_t vcvtq_s32_f32(float32x4_t a) noexcept {
+    return neonMap<int32x4_t>([=](int i) {
+        float const x = a.v[i];
+        return x != x ? 0 : x >= 2147483647.0f ? INT32_MAX : x <= -2147483648.0f ? INT32_MIN :
+                int32_t(x);
+    });
+}
+
+inline uint32x4_t vcvtq_u32_f32(float32x4_t a) noexcept {
+    return neonMap<uint32x4_t>([=](int i) {
+        float const x = a.v[i];
+        return x != x || x <= 0.0f ? 0u : x >= 4294967295.0f ? UINT32_MAX : uint32_t(x);
+    });
+}
+
+// integer arithmetic, wrapping unless saturating
+
+inline uint16x8_t vsubl_u8(uint8x8_t a, uint8x8_t b) noexcept {
+    return neonMap<uint16x8_t>([=](int i) { return uint16_t(a.v[i] - b.v[i]); });
+}
+
+inline int16x8_t vaddq_s16(int16x8_t a, int16x8_t b) noexcept {
+    return neonMap<int16x8_t>([=](int i) { return int16_t(a.v[i] + b.v[i]); });
+}
+
+inline int16x8_t vsubq_s16(int16x8_t a, int16x8_t b) noexcept {
+    return neonMap<int16x8_t>([=](int i) { return int16_t(a.v[i] - b.v[i]); });
+}
+
+inline int16x8_t vmulq_n_s16(int16x8_t a, int16_t b) noexcept {
+    return neonMap<int16x8_t>([=](int i) { return int16_t(a.v[i] * b); });
+}
+
+inline int16x8_t vmlaq_n_s16(int16x8_t a, int16x8_t b, int16_t c) noexcept {
+    return neonMap<int16x8_t>([=](int i) { return int16_t(a.v[i] + b.v[i] * c); });
+}
+
+// the rounding constant is added without overflowing
+inline int16x8_t vrshrq_n_s16(int16x8_t a, int n) noexcept {
+    return neonMap<int16x8_t>([=](int i) {
+        return int16_t((int32_t(a.v[i]) + (1 << (n - 1))) >> n);
+    });
+}
+
+inline int32x4_t vmull_s16(int16x4_t a, int16x4_t b) noexcept {
+    return neonMap<int32x4_t>([=](int i) { return int32_t(a.v[i]) * b.v[i]; });
+}
+
+inline int32x4_t vmlal_s16(int32x4_t c, int16x4_t a, int16x4_t b) noexcept {
+    return neonMap<int32x4_t>([=](int i) { return c.v[i] + int32_t(a.v[i]) * b.v[i]; });
+}
+
+inline int32x4_t vaddq_s32(int32x4_t a, int32x4_t b) noexcept {
+    return neonMap<int32x4_t>([=](int i) { return int32_t(uint32_t(a.v[i]) + uint32_t(b.v[i])); });
+}
+
+inline int32x4_t vsubq_s32(int32x4_t a, int32x4_t b) noexcept {
+    return neonMap<int32x4_t>([=](int i) { return int32_t(uint32_t(a.v[i]) - uint32_t(b.v[i])); });
+}
+
+inline int32x4_t vandq_s32(int32x4_t a, int32x4_t b) noexcept {
+    return neonMap<int32x4_t>([=](int i) { return a.v[i] & b.v[i]; });
+}
+
+inline int32x4_t vorrq_s32(int32x4_t a, int32x4_t b) noexcept {
+    return neonMap<int32x4_t>([=](int i) { return a.v[i] | b.v[i]; });
+}
+
+inline uint32x4_t vandq_u32(uint32x4_t a, uint32x4_t b) noexcept {
+    return neonMap<uint32x4_t>([=](int i) { return a.v[i] & b.v[i]; });
+}
+
+inline int32x4_t vshrq_n_s32(int32x4_t a, int n) noexcept {
+    return neonMap<int32x4_t>([=](int i) { return a.v[i] >> n; });
+}
+
+inline int32x4_t vshlq_n_s32(int32x4_t a, int n) noexcept {
+    return neonMap<int32x4_t>([=](int i) { return int32_t(uint32_t(a.v[i]) << n); });
+}
+
+inline uint32x4_t vaddq_u32(uint32x4_t a, uint32x4_t b) noexcept {
+    return neonMap<uint32x4_t>([=](int i) { return a.v[i] + b.v[i]; });
+}
+
+inline uint32x4_t vcltq_u32(uint32x4_t a, uint32x4_t b) noexcept {
+    return neonMap<uint32x4_t>([=](int i) { return a.v[i] < b.v[i] ? UINT32_MAX : 0u; });
+}
+
+inline uint32x4_t vbslq_u32(uint32x4_t mask, uint32x4_t a, uint32x4_t b) noexcept {
+    return neonMap<uint32x4_t>([=](int i) { return (mask.v[i] & a.v[i]) | (~mask.v[i] & b.v[i]); });
+}
+
+inline uint64x2_t vpaddlq_u32(uint32x4_t a) noexcept {
+    return neonMap<uint64x2_t>([=](int i) { return uint64_t(a.v[i * 2]) + a.v[i * 2 + 1]; });
+}
+
+// float arithmetic, vmlaq_f32 isn't fused
+
+inline float32x4_t vaddq_f32(float32x4_t a, float32x4_t b) noexcept {
+    return neonMap<float32x4_t>([=](int i) { return a.v[i] + b.v[i]; });
+}
+
+inline float32x4_t vsubq_f32(float32x4_t a, float32x4_t b) noexcept {
+    return neonMap<float32x4_t>([=](int i) { return a.v[i] - b.v[i]; });
+}
+
+inline float32x4_t vmulq_f32(float32x4_t a, float32x4_t b) noexcept {
+    return neonMap<float32x4_t>([=](int i) { return a.v[i] * b.v[i]; });
+}
+
+inline float32x4_t vmlaq_f32(float32x4_t a, float32x4_t b, float32x4_t c) noexcept {
+    return neonMap<float32x4_t>([=](int i) {
+        float const product = b.v[i] * c.v[i];
+        return a.v[i] + product;
+    });
+}
+
+inline float32x4_t vdivq_f32(float32x4_t a, float32x4_t b) noexcept {
+    return neonMap<float32x4_t>([=](int i) { return a.v[i] / b.v[i]; });
+}
+
+inline float32x4_t vsqrtq_f32(float32x4_t a) noexcept {
+    return neonMap<float32x4_t>([=](int i) { return sqrtf(a.v[i]); });
+}
+
+inline float32x4_t vrndpq_f32(float32x4_t a) noexcept {
+    return neonMap<float32x4_t>([=](int i) { return ceilf(a.v[i]); });
+}
+
+// NaN if either operand is
+inline float32x4_t vmaxq_f32(float32x4_t a, float32x4_t b) noexcept {
+    return neonMap<float32x4_t>([=](int i) {
+        return a.v[i] != a.v[i] || b.v[i] != b.v[i] ? NAN : fmaxf(a.v[i], b.v[i]);
+    });
+}
+
+inline float32x4_t vminq_f32(float32x4_t a, float32x4_t b) noexcept {
+    return neonMap<float32x4_t>([=](int i) {
+        return a.v[i] != a.v[i] || b.v[i] != b.v[i] ? NAN : fminf(a.v[i], b.v[i]);
+    });
+}
+
+inline uint32x4_t vcgtq_f32(float32x4_t a, float32x4_t b) noexcept {
+    return neonMap<uint32x4_t>([=](int i) { return a.v[i] > b.v[i] ? UINT32_MAX : 0u; });
+}
+
+inline uint32x4_t vcleq_f32(float32x4_t a, float32x4_t b) noexcept {
+    return neonMap<uint32x4_t>([=](int i) { return a.v[i] <= b.v[i] ? UINT32_MAX : 0u; });
+}
+
+inline float32x4_t vbslq_f32(uint32x4_t mask, float32x4_t a, float32x4_t b) noexcept {
+    return neonCast<float32x4_t>(vbslq_u32(mask, neonCast<uint32x4_t>(a),
+            neonCast<uint32x4_t>(b)));
+}
+
+#endif // TNT_FILAMENT_SAMPLE_TEST_ARM_NEON_H